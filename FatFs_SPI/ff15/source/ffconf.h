@@ -2,6 +2,10 @@
 /  Configurations of FatFs Module
 /---------------------------------------------------------------------------*/
 
+#ifdef FF_PLAYER_PROFILE
+#include "ffconf_player.h"	/* The read-only set FatFs_SPI_player builds with */
+#else
+
 #define FFCONF_DEF	80286	/* Revision ID */
 
 /*---------------------------------------------------------------------------/
@@ -294,3 +298,5 @@
 
 
 /*--- End of configuration options ---*/
+
+#endif /* FF_PLAYER_PROFILE */
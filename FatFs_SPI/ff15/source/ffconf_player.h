@@ -0,0 +1,58 @@
+/*---------------------------------------------------------------------------/
+/  Configurations of FatFs Module for the player (FatFs_SPI_player)
+/
+/  The player only opens, reads and seeks files on a FAT32 card, so everything
+/  else is left out: no writing or f_mkfs, 8.3 names only (no LFN buffer and
+/  no ffunicode.c tables), no exFAT, no file lock table, one volume.
+/  ffconf.h includes this in place of its own options when FF_PLAYER_PROFILE
+/  is defined. See the option descriptions there.
+/---------------------------------------------------------------------------*/
+
+#define FFCONF_DEF	80286	/* Revision ID */
+
+#define FF_FS_READONLY	1
+#define FF_FS_MINIMIZE	0	/* f_stat stays, the rest is gone with read-only anyway */
+#define FF_USE_FIND		0
+#define FF_USE_MKFS		0
+#define FF_USE_FASTSEEK	1	/* link maps, for reading frames with disk_read_async */
+#define FF_USE_EXPAND	0
+#define FF_USE_CHMOD	0
+#define FF_USE_LABEL	0
+#define FF_USE_FORWARD	0
+#define FF_USE_STRFUNC	1	/* f_gets, for the playlist */
+#define FF_PRINT_LLI	0
+#define FF_PRINT_FLOAT	0
+#define FF_STRF_ENCODE	0
+
+#define FF_CODE_PAGE	437
+
+#define FF_USE_LFN		0
+#define FF_MAX_LFN		255
+#define FF_LFN_UNICODE	0
+#define FF_LFN_BUF		255
+#define FF_SFN_BUF		12
+#define FF_FS_RPATH		0
+
+#define FF_VOLUMES		1
+#define FF_STR_VOLUME_ID	0
+#define FF_VOLUME_STRS		"RAM","NAND","CF","SD","SD2","USB","USB2","USB3"
+#define FF_MULTI_PARTITION	0
+
+#define FF_MIN_SS		512
+#define FF_MAX_SS		512
+#define FF_LBA64		0
+#define FF_MIN_GPT		0x10000000
+#define FF_USE_TRIM		0
+
+#define FF_FS_TINY		0	/* keeps a sector buffer per file, so frame reads don't fight the FAT over one */
+#define FF_FS_EXFAT		0
+#define FF_FS_NORTC		1
+#define FF_NORTC_MON	1
+#define FF_NORTC_MDAY	1
+#define FF_NORTC_YEAR	2022
+#define FF_FS_NOFSINFO	0
+#define FF_FS_LOCK		0
+#define FF_FS_REENTRANT	0
+#define FF_FS_TIMEOUT	1000
+
+/*--- End of configuration options ---*/
@@ -0,0 +1,54 @@
+/* diskio_async.h
+Non-blocking sector reads for the FatFs glue layer (see glue.c).
+
+Licensed under the Apache License, Version 2.0 (the License); you may not use 
+this file except in compliance with the License. You may obtain a copy of the 
+License at
+
+   http://www.apache.org/licenses/LICENSE-2.0 
+Unless required by applicable law or agreed to in writing, software distributed 
+under the License is distributed on an AS IS BASIS, WITHOUT WARRANTIES OR 
+CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+specific language governing permissions and limitations under the License.
+*/
+#pragma once
+
+#include <stdbool.h>
+//
+#include "ff.h"
+#include "diskio.h"
+
+// Result of an async read that ran out of budget, alongside FatFs's DRESULT codes
+#define RES_LATE ((DRESULT)(RES_PARERR + 1))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Bounds every async read on the drive started from now on to budget_us (0
+    // for no limit). Failed blocks get re-read while there's time; one still not
+    // done when it runs out ends with RES_LATE rather than waiting on the card.
+    void disk_read_budget(BYTE pdrv, UINT budget_us);
+
+    // Starts reading count sectors into buff and returns as soon as the first
+    // block is in flight. The drive stays busy until disk_read_poll reports done.
+    DRESULT disk_read_async(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count);
+
+    // Same, but the sectors land in runs of run sectors with gap bytes of buff
+    // skipped between runs, the first run being first_run sectors long.
+    DRESULT disk_read_async_strided(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count,
+                                    UINT first_run, UINT run, UINT gap);
+
+    // Returns true once the read has finished and stores its result.
+    // While it returns false, *sectors_done (may be NULL) tells how many
+    // sectors at the front of buff are already valid.
+    bool disk_read_poll(BYTE pdrv, DRESULT *result, UINT *sectors_done);
+
+    // Blocks until the read in progress (if any) has finished.
+    DRESULT disk_read_wait(BYTE pdrv);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* [] END OF FILE */
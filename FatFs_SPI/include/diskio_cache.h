@@ -0,0 +1,43 @@
+/* diskio_cache.h
+Sector cache in the FatFs glue layer (see glue.c).
+
+Licensed under the Apache License, Version 2.0 (the License); you may not use 
+this file except in compliance with the License. You may obtain a copy of the 
+License at
+
+   http://www.apache.org/licenses/LICENSE-2.0 
+Unless required by applicable law or agreed to in writing, software distributed 
+under the License is distributed on an AS IS BASIS, WITHOUT WARRANTIES OR 
+CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+specific language governing permissions and limitations under the License.
+*/
+#pragma once
+
+#include <stdint.h>
+
+// Sectors fetched in one multi-block read when single sector reads turn
+// out to be sequential. 0 turns the cache off.
+#ifndef DISK_CACHE_AHEAD
+#define DISK_CACHE_AHEAD 4
+#endif
+
+// FAT sectors kept apart from the read-ahead, least recently used goes first
+#ifndef DISK_CACHE_FAT
+#define DISK_CACHE_FAT 2
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if DISK_CACHE_AHEAD
+    // Single sector reads answered from the cache, and those that went to the card
+    extern volatile uint32_t disk_cache_hits;
+    extern volatile uint32_t disk_cache_misses;
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/* [] END OF FILE */
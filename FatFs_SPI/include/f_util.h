@@ -19,11 +19,14 @@ extern "C" {
 #endif
 
     const char *FRESULT_str(FRESULT i);
+#if !FF_FS_READONLY
     FRESULT delete_node (
         TCHAR* path,    /* Path name buffer with the sub-directory to delete */
         UINT sz_buff,   /* Size of path name buffer (items) */
         FILINFO* fno    /* Name read buffer */
     );
+#endif
+    FRESULT f_file_sector(FIL *fp, FSIZE_t ofs, LBA_t *sector, UINT *run);
 
 #ifdef __cplusplus
 }
@@ -56,22 +56,37 @@ typedef struct {
 
 FF_FILE *ff_fopen(const char *pcFile, const char *pcMode);
 int ff_fclose(FF_FILE *pxStream);
+size_t ff_fread(void *pvBuffer, size_t xSize, size_t xItems, FF_FILE *pxStream);
+int ff_fgetc(FF_FILE *pxStream);
+long ff_ftell(FF_FILE *pxStream);
+int ff_fseek(FF_FILE *pxStream, int iOffset, int iWhence);
+#if FF_FS_MINIMIZE < 1
 int ff_stat(const char *pcFileName, FF_Stat_t *pxStatBuffer);
+#endif
+#if FF_USE_STRFUNC
+char *ff_fgets(char *pcBuffer, size_t xCount, FF_FILE *pxStream);
+#endif
+// Left out of read-only builds, such as the player's (FatFs_SPI_player):
+#if !FF_FS_READONLY
 size_t ff_fwrite(const void *pvBuffer, size_t xSize, size_t xItems,
                  FF_FILE *pxStream);
-size_t ff_fread(void *pvBuffer, size_t xSize, size_t xItems, FF_FILE *pxStream);
-int ff_chdir(const char *pcDirectoryName);
-char *ff_getcwd(char *pcBuffer, size_t xBufferLength);
 int ff_mkdir(const char *pcPath);
 int ff_fputc(int iChar, FF_FILE *pxStream);
-int ff_fgetc(FF_FILE *pxStream);
 int ff_rmdir(const char *pcDirectory);
 int ff_remove(const char *pcPath);
-long ff_ftell(FF_FILE *pxStream);
-int ff_fseek(FF_FILE *pxStream, int iOffset, int iWhence);
-int ff_findfirst(const char *pcDirectory, FF_FindData_t *pxFindData);
-int ff_findnext( FF_FindData_t *pxFindData );
 FF_FILE *ff_truncate( const char * pcFileName, long lTruncateSize );
 int ff_seteof( FF_FILE *pxStream );
 int ff_rename( const char *pcOldName, const char *pcNewName, int bDeleteIfExists );
-char *ff_fgets(char *pcBuffer, size_t xCount, FF_FILE *pxStream);
+#endif
+#if FF_FS_RPATH >= 1
+int ff_chdir(const char *pcDirectoryName);
+#endif
+#if FF_FS_RPATH >= 2
+char *ff_getcwd(char *pcBuffer, size_t xBufferLength);
+#endif
+#if FF_USE_FIND && FF_FS_RPATH >= 2
+int ff_findfirst(const char *pcDirectory, FF_FindData_t *pxFindData);
+#endif
+#if FF_USE_FIND
+int ff_findnext( FF_FindData_t *pxFindData );
+#endif
@@ -163,6 +163,8 @@ specific language governing permissions and limitations under the License.
 #include <inttypes.h>
 #include <string.h>
 //
+#include "hardware/clocks.h"
+#include "hardware/timer.h"
 #include "pico/mutex.h"
 //
 #include "hw_config.h"  // Hardware Configuration of the SPI and SD Card "objects"
@@ -184,6 +186,11 @@ specific language governing permissions and limitations under the License.
 static bool crc_on = true;
 #endif
 
+// Step SCK up after initialization for as long as test reads stay clean
+#ifndef SD_BAUD_RAMP
+#define SD_BAUD_RAMP 1
+#endif
+
 #define TRACE_PRINTF(fmt, args...)
 // #define TRACE_PRINTF printf
 
@@ -294,6 +301,8 @@ typedef enum {
 
 #define SPI_CMD(x) (0x40 | (x & 0x3f))
 
+#define SD_NCR_BYTES 8 /*!< Response window clocked along with each command */
+
 static uint8_t sd_cmd_spi(sd_card_t *pSD, cmdSupported cmd, uint32_t arg) {
     uint8_t response;
     char cmdPacket[PACKET_SIZE];
@@ -325,18 +334,29 @@ static uint8_t sd_cmd_spi(sd_card_t *pSD, cmdSupported cmd, uint32_t arg) {
                 break;
         }
     }
-    // send a command
-    for (int i = 0; i < PACKET_SIZE; i++) {
-        sd_spi_write(pSD, cmdPacket[i]);
-    }
+    // Send the command and clock the whole response window in one transfer.
     // The received byte immediataly following CMD12 is a stuff byte,
     // it should be discarded before receive the response of the CMD12.
-    if (CMD12_STOP_TRANSMISSION == cmd) {
-        sd_spi_write(pSD, SPI_FILL_CHAR);
+    uint8_t frame[PACKET_SIZE + 1 + SD_NCR_BYTES];
+    uint8_t rx[sizeof frame];
+    size_t start = PACKET_SIZE + (CMD12_STOP_TRANSMISSION == cmd ? 1 : 0);
+    size_t length = start + SD_NCR_BYTES;
+    memcpy(frame, cmdPacket, PACKET_SIZE);
+    memset(frame + PACKET_SIZE, SPI_FILL_CHAR, sizeof frame - PACKET_SIZE);
+    sd_spi_transfer(pSD, frame, rx, length);
+
+    // Response is sent back within command response time (NCR), 0 to 8 bytes
+    // for SDC. Whatever followed it (R3/R7 bytes, busy, or the card idling
+    // before a data token) is kept for the reads that come next.
+    for (size_t i = start; i < length; i++) {
+        response = rx[i];
+        if (!(response & R1_RESPONSE_RECV)) {
+            sd_spi_keep_ahead(pSD, rx + i + 1, length - i - 1);
+            return response;
+        }
     }
-    // Loop for response: Response is sent back within command response time
-    // (NCR), 0 to 8 bytes for SDC
-    for (int i = 0; i < 0x10; i++) {
+    // Slow card: keep polling a byte at a time, as long as before
+    for (int i = SD_NCR_BYTES; i < 0x10; i++) {
         response = sd_spi_write(pSD, SPI_FILL_CHAR);
         // Got the response
         if (!(response & R1_RESPONSE_RECV)) {
@@ -346,12 +366,23 @@ static uint8_t sd_cmd_spi(sd_card_t *pSD, cmdSupported cmd, uint32_t arg) {
     return response;
 }
 
+// When a wait of timeout ms has to give up, or sooner if an async read's
+// deadline comes first.
+static absolute_time_t sd_timeout_time(sd_card_t *pSD, int timeout) {
+    absolute_time_t timeout_time = make_timeout_time_ms(timeout);
+    if (!is_nil_time(pSD->async.deadline) &&
+        0 < absolute_time_diff_us(pSD->async.deadline, timeout_time)) {
+        timeout_time = pSD->async.deadline;
+    }
+    return timeout_time;
+}
+
 static bool sd_wait_ready(sd_card_t *pSD, int timeout) {
     char resp;
 
     // Keep sending dummy clocks with DI held high until the card releases the
     // DO line
-    absolute_time_t timeout_time = make_timeout_time_ms(timeout);
+    absolute_time_t timeout_time = sd_timeout_time(pSD, timeout);
     do {
         resp = sd_spi_write(pSD, 0xFF);
     } while (resp == 0x00 &&
@@ -450,8 +481,8 @@ static const char *cmd2str(const cmdSupported cmd) {
 #define SD_COMMAND_RETRIES 3 /*!< Times SPI cmd is retried when there is no response */
 #define SD_COMMAND_TIMEOUT 2000 /*!< Timeout in ms for response */
 
-static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
-                  bool isAcmd, uint32_t *resp) {
+static int in_sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
+                     bool isAcmd, uint32_t *resp) {
     TRACE_PRINTF("%s(%s(0x%08lx)): ", __FUNCTION__, cmd2str(cmd), arg);
 
     int32_t status = SD_BLOCK_DEVICE_ERROR_NONE;
@@ -611,6 +642,15 @@ static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
     return status;
 }
 
+static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
+                  bool isAcmd, uint32_t *resp) {
+    uint32_t start = time_us_32();
+    int status = in_sd_cmd(pSD, cmd, arg, isAcmd, resp);
+    pSD->cmd_stats[cmd & 0x3F].count++;
+    pSD->cmd_stats[cmd & 0x3F].us += time_us_32() - start;
+    return status;
+}
+
 /* Return non-zero if the SD-card is present. */
 bool sd_card_detect(sd_card_t *pSD) {
     TRACE_PRINTF("> %s\r\n", __FUNCTION__);
@@ -759,16 +799,30 @@ uint64_t sd_sectors(sd_card_t *pSD) {
     return sectors;
 }
 
+#define SD_TOKEN_CHUNK 8 /*!< Bytes clocked at a time while waiting for a start token */
+
 // SPI function to wait till chip is ready and sends start token
 static bool sd_wait_token(sd_card_t *pSD, uint8_t token) {
     TRACE_PRINTF("%s(0x%02hhx)\r\n", __FUNCTION__, token);
 
-    const uint32_t timeout = SD_COMMAND_TIMEOUT;  // Wait for start token
-    absolute_time_t timeout_time = make_timeout_time_ms(timeout);
-    do {
+    // Look through what the command already read ahead first
+    while (pSD->rx_ahead_len) {
         if (token == sd_spi_write(pSD, SPI_FILL_CHAR)) {
             return true;
         }
+    }
+    // Then hunt in small chunks, keeping any data clocked in past the token
+    const uint32_t timeout = SD_COMMAND_TIMEOUT;  // Wait for start token
+    absolute_time_t timeout_time = sd_timeout_time(pSD, timeout);
+    uint8_t chunk[SD_TOKEN_CHUNK];
+    do {
+        sd_spi_transfer(pSD, NULL, chunk, sizeof chunk);
+        for (size_t i = 0; i < sizeof chunk; i++) {
+            if (token == chunk[i]) {
+                sd_spi_keep_ahead(pSD, chunk + i + 1, sizeof chunk - i - 1);
+                return true;
+            }
+        }
     } while (0 < absolute_time_diff_us(get_absolute_time(), timeout_time));
     DBG_PRINTF("sd_wait_token: timeout\r\n");
     return false;
@@ -786,8 +840,8 @@ static int sd_read_bytes(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
         return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
     }
     // read data
-    for (uint32_t i = 0; i < length; i++) {
-        buffer[i] = sd_spi_write(pSD, SPI_FILL_CHAR);
+    if (!sd_spi_transfer(pSD, NULL, buffer, length)) {
+        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
     }
     // Read the CRC16 checksum for the data block
     crc = (sd_spi_write(pSD, SPI_FILL_CHAR) << 8);
@@ -809,19 +863,41 @@ static int sd_read_bytes(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
 
     return 0;
 }
-static int sd_read_block(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
-    uint16_t crc;
-
+// Wait for the start token, then kick off the DMA for the data phase.
+static int sd_read_block_start(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
     // read until start byte (0xFE)
     if (false == sd_wait_token(pSD, SPI_START_BLOCK)) {
         DBG_PRINTF("%s:%d Read timeout\r\n", __FILE__, __LINE__);
         return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
     }
-    // read data
-    // bool spi_transfer(const uint8_t *tx, uint8_t *rx, size_t length)
-    if (!sd_spi_transfer(pSD, NULL, buffer, length)) {
-        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+    // read data, the start of it may already have come in with the token
+    size_t ahead = sd_spi_take_ahead(pSD, buffer, length);
+    if (ahead == length) {
+        pSD->spi->rx_crc_valid = false;
+        return SD_BLOCK_DEVICE_ERROR_NONE;
+    }
+    bool started;
+#if SD_CRC_ENABLED
+    if (crc_on) {
+        // Let the DMA sniffer checksum the rest on its way in
+        uint16_t seed = crc16((void *)buffer, ahead);
+        started = spi_transfer_start_crc(pSD->spi, buffer + ahead, length - ahead, seed);
+    } else
+#endif
+    {
+        started = spi_transfer_start(pSD->spi, NULL, buffer + ahead, length - ahead);
     }
+    return started ? SD_BLOCK_DEVICE_ERROR_NONE : SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+}
+// Collect the CRC trailing a block whose data phase has completed.
+static int sd_read_block_finish(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
+    uint16_t crc;
+#if SD_CRC_ENABLED
+    // Take what the sniffer computed before the next transfer resets it
+    bool sniffed = pSD->spi->rx_crc_valid;
+    uint16_t sniffed_crc = pSD->spi->rx_crc;
+#endif
+
     // Read the CRC16 checksum for the data block
     crc = (sd_spi_write(pSD, SPI_FILL_CHAR) << 8);
     crc |= sd_spi_write(pSD, SPI_FILL_CHAR);
@@ -829,8 +905,13 @@ static int sd_read_block(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
 #if SD_CRC_ENABLED
     if (crc_on) {
         uint32_t crc_result;
-        // Compute and verify checksum
-        crc_result = crc16((void *)buffer, length);
+        // Verify the checksum the sniffer computed, or compute it here if it
+        // wasn't free
+        if (sniffed) {
+            crc_result = sniffed_crc;
+        } else {
+            crc_result = crc16((void *)buffer, length);
+        }
         if ((uint16_t)crc_result != crc) {
             DBG_PRINTF("%s: Invalid CRC received 0x%" PRIx16
                        " result of computation 0x%" PRIx16 "\r\n",
@@ -842,18 +923,25 @@ static int sd_read_block(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
 
     return SD_BLOCK_DEVICE_ERROR_NONE;
 }
+static int sd_read_block(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
+    int status = sd_read_block_start(pSD, buffer, length);
+    if (SD_BLOCK_DEVICE_ERROR_NONE != status) {
+        return status;
+    }
+    if (!spi_transfer_wait_complete(pSD->spi, 1000)) {
+        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+    }
+    return sd_read_block_finish(pSD, buffer, length);
+}
 
-static int in_sd_read_blocks(sd_card_t *pSD, uint8_t *buffer,
-                             uint64_t ulSectorNumber, uint32_t ulSectorCount) {
-    uint32_t blockCnt = ulSectorCount;
-
+// Validate a read request and send CMD17/CMD18 for it.
+static int sd_read_blocks_command(sd_card_t *pSD, uint64_t ulSectorNumber,
+                                  uint32_t blockCnt) {
     if (ulSectorNumber + blockCnt > pSD->sectors)
         return SD_BLOCK_DEVICE_ERROR_PARAMETER;
     if (pSD->m_Status & (STA_NOINIT | STA_NODISK))
         return SD_BLOCK_DEVICE_ERROR_PARAMETER;
 
-    int status = SD_BLOCK_DEVICE_ERROR_NONE;
-
     uint64_t addr;
     // SDSC Card (CCS=0) uses byte unit address
     // SDHC and SDXC Cards (CCS=1) use block unit address (512 Bytes unit)
@@ -864,10 +952,17 @@ static int in_sd_read_blocks(sd_card_t *pSD, uint8_t *buffer,
     }
     // Write command ro receive data
     if (blockCnt > 1) {
-        status = sd_cmd(pSD, CMD18_READ_MULTIPLE_BLOCK, addr, false, 0);
+        return sd_cmd(pSD, CMD18_READ_MULTIPLE_BLOCK, addr, false, 0);
     } else {
-        status = sd_cmd(pSD, CMD17_READ_SINGLE_BLOCK, addr, false, 0);
+        return sd_cmd(pSD, CMD17_READ_SINGLE_BLOCK, addr, false, 0);
     }
+}
+
+static int in_sd_read_blocks(sd_card_t *pSD, uint8_t *buffer,
+                             uint64_t ulSectorNumber, uint32_t ulSectorCount) {
+    uint32_t blockCnt = ulSectorCount;
+
+    int status = sd_read_blocks_command(pSD, ulSectorNumber, blockCnt);
     if (SD_BLOCK_DEVICE_ERROR_NONE != status) {
         return status;
     }
@@ -898,6 +993,167 @@ int sd_read_blocks(sd_card_t *pSD, uint8_t *buffer, uint64_t ulSectorNumber,
     return status;
 }
 
+static int sd_read_blocks_async_end(sd_card_t *pSD, int status) {
+    // Send CMD12(0x00000000) to stop the transmission for multi-block transfer
+    if (pSD->async.multi) {
+        int stop_status = sd_cmd(pSD, CMD12_STOP_TRANSMISSION, 0x0, false, 0);
+        if (SD_BLOCK_DEVICE_ERROR_NONE == status) status = stop_status;
+    }
+    pSD->async.active = false;
+    pSD->async.status = status;
+    pSD->async.deadline = nil_time;
+    sd_release(pSD);
+    if (pSD->async.done_cb) {
+        pSD->async.done_cb(pSD, status, pSD->async.context);
+    }
+    return status;
+}
+
+#define SD_READ_RETRIES 2 /*!< Times an async read is re-issued after a block fails */
+
+// Pick an async read up again from the block that failed, as long as there are
+// retries and time left. Returns SD_BLOCK_DEVICE_ERROR_NONE with the read under
+// way again, otherwise the error to end it with.
+static int sd_read_blocks_async_retry(sd_card_t *pSD, int status) {
+    while (SD_BLOCK_DEVICE_ERROR_NONE != status) {
+        if (!is_nil_time(pSD->async.deadline) && time_reached(pSD->async.deadline)) {
+            pSD->late_reads++;
+            return SD_BLOCK_DEVICE_ERROR_LATE;
+        }
+        if (SD_BLOCK_DEVICE_ERROR_CRC != status &&
+            SD_BLOCK_DEVICE_ERROR_NO_RESPONSE != status) {
+            return status;  // Asking again won't change the answer
+        }
+        if (!pSD->async.retries_left) return status;
+        pSD->async.retries_left--;
+        pSD->read_retries++;
+        DBG_PRINTF("%s: re-reading from block %lu\r\n", __FUNCTION__,
+                   pSD->async.blocks_done);
+
+        // Re-sync: stop the card sending, then ask for the rest again
+        if (pSD->async.multi) {
+            sd_cmd(pSD, CMD12_STOP_TRANSMISSION, 0x0, false, 0);
+        }
+        uint64_t sector = pSD->async.sector + pSD->async.blocks_done;
+        pSD->async.multi = pSD->async.blocks_left > 1;
+        status = sd_read_blocks_command(pSD, sector, pSD->async.blocks_left);
+        if (SD_BLOCK_DEVICE_ERROR_NONE == status) {
+            status = sd_read_block_start(pSD, pSD->async.buffer, _block_size);
+        } else {
+            pSD->async.multi = false;
+        }
+    }
+    pSD->async.active = true;
+    return status;
+}
+
+static int sd_read_blocks_async_start(sd_card_t *pSD, uint8_t *buffer, uint64_t ulSectorNumber,
+                                      uint32_t ulSectorCount, sd_read_done_cb_t done_cb,
+                                      void *context) {
+    myASSERT(!pSD->async.active);
+    if (!ulSectorCount) return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+
+    sd_acquire(pSD);
+    TRACE_PRINTF("sd_read_blocks_async(0x%p, 0x%llx, 0x%lx)\r\n", buffer,
+                 ulSectorNumber, ulSectorCount);
+    pSD->async.buffer = buffer;
+    pSD->async.blocks_left = ulSectorCount;
+    pSD->async.blocks_done = 0;
+    pSD->async.multi = ulSectorCount > 1;
+    pSD->async.done_cb = done_cb;
+    pSD->async.context = context;
+    pSD->async.sector = ulSectorNumber;
+    pSD->async.retries_left = SD_READ_RETRIES;
+    pSD->async.deadline = pSD->read_budget_us ? make_timeout_time_us(pSD->read_budget_us) : nil_time;
+
+    int status = sd_read_blocks_command(pSD, ulSectorNumber, ulSectorCount);
+    if (SD_BLOCK_DEVICE_ERROR_NONE == status) {
+        status = sd_read_block_start(pSD, buffer, _block_size);
+        // If that failed, the command was accepted, so a multi-block read still needs its CMD12
+    } else {
+        pSD->async.multi = false;
+    }
+    status = sd_read_blocks_async_retry(pSD, status);
+    if (SD_BLOCK_DEVICE_ERROR_NONE == status) {
+        return status;
+    }
+    pSD->async.done_cb = NULL;  // Failing to start is reported by the return value only
+    return sd_read_blocks_async_end(pSD, status);
+}
+
+/** Start reading blocks without waiting for the data
+ *
+ *  Sends the read command and starts the DMA for the first block, then returns.
+ *  Call sd_read_blocks_poll() until it stops returning
+ *  SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK; async.blocks_done tells how much of the
+ *  buffer is already valid while the rest is in flight. done_cb (may be NULL)
+ *  is called from the poll that finishes the transfer.
+ *
+ *  @return         SD_BLOCK_DEVICE_ERROR_NONE(0) if the read is under way,
+ *                  otherwise the error that prevented it from starting
+ */
+int sd_read_blocks_async(sd_card_t *pSD, uint8_t *buffer, uint64_t ulSectorNumber,
+                         uint32_t ulSectorCount, sd_read_done_cb_t done_cb,
+                         void *context) {
+    pSD->async.run_blocks = 0;
+    return sd_read_blocks_async_start(pSD, buffer, ulSectorNumber, ulSectorCount,
+                                      done_cb, context);
+}
+
+/** Start a gathered read: runs of run_blocks blocks with gap bytes between
+ *  them in the buffer, the first run being first_run blocks long. Poll it like
+ *  sd_read_blocks_async(); async.blocks_done still counts blocks. */
+int sd_read_blocks_async_strided(sd_card_t *pSD, uint8_t *buffer, uint64_t ulSectorNumber,
+                                 uint32_t ulSectorCount, uint32_t first_run, uint32_t run_blocks,
+                                 uint32_t gap) {
+    if (!first_run || first_run > run_blocks) return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+    pSD->async.run_blocks = run_blocks;
+    pSD->async.run_left = first_run;
+    pSD->async.gap = gap;
+    return sd_read_blocks_async_start(pSD, buffer, ulSectorNumber, ulSectorCount, NULL, NULL);
+}
+
+/** Advance an asynchronous read
+ *
+ *  Never waits for the data phase of a block; it only waits (briefly) for the
+ *  start token of the next block once the previous one has landed. A block that
+ *  fails its CRC or never sends its token is asked for again, up to
+ *  SD_READ_RETRIES times, unless the read's deadline has passed.
+ *
+ *  @return         SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK while blocks are in flight,
+ *                  otherwise the final status of the read, SD_BLOCK_DEVICE_ERROR_LATE
+ *                  if it failed at or after its deadline
+ */
+int sd_read_blocks_poll(sd_card_t *pSD) {
+    if (!pSD->async.active) return pSD->async.status;
+    if (!spi_transfer_is_complete(pSD->spi)) return SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK;
+
+    int status = sd_read_block_finish(pSD, pSD->async.buffer, _block_size);
+    if (SD_BLOCK_DEVICE_ERROR_NONE != status) {
+        status = sd_read_blocks_async_retry(pSD, status);
+        if (SD_BLOCK_DEVICE_ERROR_NONE == status) return SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK;
+        return sd_read_blocks_async_end(pSD, status);
+    }
+    pSD->async.buffer += _block_size;
+    if (pSD->async.run_blocks && !--pSD->async.run_left) {
+        // The other card's stripe goes here
+        pSD->async.buffer += pSD->async.gap;
+        pSD->async.run_left = pSD->async.run_blocks;
+    }
+    pSD->async.blocks_done++;
+    if (--pSD->async.blocks_left) {
+        status = sd_read_block_start(pSD, pSD->async.buffer, _block_size);
+        if (SD_BLOCK_DEVICE_ERROR_NONE != status) {
+            status = sd_read_blocks_async_retry(pSD, status);
+            if (SD_BLOCK_DEVICE_ERROR_NONE != status) {
+                return sd_read_blocks_async_end(pSD, status);
+            }
+        }
+        return SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK;
+    }
+    return sd_read_blocks_async_end(pSD, SD_BLOCK_DEVICE_ERROR_NONE);
+}
+
 static uint8_t sd_write_block(sd_card_t *pSD, const uint8_t *buffer,
                               uint8_t token, uint32_t length) {
     uint16_t crc = (~0);
@@ -1024,6 +1280,74 @@ int sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
     return status;
 }
 
+/* CMD6 argument: bit 31 is switch (1) or check (0) mode, and each nibble of
+ * [23:0] picks a function for one group, 0xF keeps the current one. Function 1
+ * of group 1 (access mode) is high speed, SCK up to 50 MHz. */
+#define CMD6_CHECK_HIGH_SPEED (0x00FFFFF1)
+#define CMD6_SWITCH_HIGH_SPEED (0x80FFFFF1)
+#define SD_SWITCH_STATUS_SIZE 64 /*!< 512 bit status block sent after CMD6 */
+
+#define SD_DEFAULT_SPEED_HZ (25 * 1000 * 1000)
+#define SD_HIGH_SPEED_HZ (50 * 1000 * 1000)
+
+static bool sd_switch_high_speed(sd_card_t *pSD) {
+    uint8_t status[SD_SWITCH_STATUS_SIZE];
+
+    // Check mode first, it changes nothing on the card
+    if (SD_BLOCK_DEVICE_ERROR_NONE !=
+        sd_cmd(pSD, CMD6_SWITCH_FUNC, CMD6_CHECK_HIGH_SPEED, false, 0)) {
+        return false;
+    }
+    if (0 != sd_read_bytes(pSD, status, sizeof status)) {
+        return false;
+    }
+    // Bits 415:400 are the functions group 1 supports (bit 401 is high
+    // speed), bits 379:376 the function the card would switch to
+    if (!(status[13] & 0x02) || 0x1 != (status[16] & 0x0F)) {
+        DBG_PRINTF("High speed not supported\r\n");
+        return false;
+    }
+    if (SD_BLOCK_DEVICE_ERROR_NONE !=
+        sd_cmd(pSD, CMD6_SWITCH_FUNC, CMD6_SWITCH_HIGH_SPEED, false, 0)) {
+        return false;
+    }
+    if (0 != sd_read_bytes(pSD, status, sizeof status)) {
+        return false;
+    }
+    if (0x1 != (status[16] & 0x0F)) {
+        DBG_PRINTF("Switch to high speed failed\r\n");
+        return false;
+    }
+    // The new timing is in effect 8 clocks after the end of the status block
+    sd_spi_write(pSD, SPI_FILL_CHAR);
+    DBG_PRINTF("Card switched to high speed\r\n");
+    return true;
+}
+
+#define SD_STATUS_SIZE 64 /*!< 512 bit SD status sent after ACMD13 */
+
+/* AU_SIZE codes of the SD status in 512 byte sectors, 0 is not defined */
+static const uint32_t sd_au_sectors[16] = {
+    0,     32,    64,    128,   256,   512,   1024,  2048,
+    4096,  8192,  16384, 24576, 32768, 49152, 65536, 131072};
+
+/* Reads the allocation unit size from the SD status. Returns 0 if the card
+ * doesn't say. */
+static uint32_t sd_read_au_size(sd_card_t *pSD) {
+    uint8_t status[SD_STATUS_SIZE];
+    if (SD_BLOCK_DEVICE_ERROR_NONE !=
+        sd_cmd(pSD, ACMD13_SD_STATUS, 0x0, true, 0)) {
+        return 0;
+    }
+    if (0 != sd_read_bytes(pSD, status, sizeof status)) {
+        return 0;
+    }
+    // Bits 431:428 are AU_SIZE
+    uint32_t au = sd_au_sectors[status[10] >> 4];
+    DBG_PRINTF("Allocation unit: %lu sectors\r\n", au);
+    return au;
+}
+
 static int sd_init_medium(sd_card_t *pSD) {
     int32_t status = SD_BLOCK_DEVICE_ERROR_NONE;
     uint32_t response, arg;
@@ -1117,6 +1441,13 @@ static int sd_init_medium(sd_card_t *pSD) {
         DBG_PRINTF("Card Initialized: Version 1.x Card\r\n");
     }
 
+    // Class 10 (switch) commands start with version 1.10, so only ask V2 cards.
+    // Failing to switch is fine, the card just stays at default speed.
+    if (SDCARD_V1 != pSD->card_type) {
+        pSD->high_speed = sd_switch_high_speed(pSD);
+        pSD->au_sectors = sd_read_au_size(pSD);
+    }
+
 #if SD_CRC_ENABLED
     if (!crc_on) {
         // Disable CRC
@@ -1128,6 +1459,54 @@ static int sd_init_medium(sd_card_t *pSD) {
 
     return status;
 }
+#if SD_BAUD_RAMP
+
+#define SD_RAMP_READS 8 /*!< Clean reads of the test sector needed at each rate */
+
+/* Steps SCK up one divider at a time from the configured rate towards the
+ * most the card's timing allows, reading sector 0 over and over at each step.
+ * Stops at the first rate where a read fails (CRC included, when it is on) or
+ * comes back different, and returns to the last rate that read cleanly. */
+static uint sd_ramp_baud_rate(sd_card_t *pSD) {
+    static uint8_t reference[BLOCK_SIZE_HC];
+    static uint8_t check[BLOCK_SIZE_HC];
+    uint limit = pSD->high_speed ? SD_HIGH_SPEED_HZ : SD_DEFAULT_SPEED_HZ;
+    uint good = sd_spi_set_frequency(pSD, pSD->spi->baud_rate);
+    if (0 != in_sd_read_blocks(pSD, reference, 0, 1)) {
+        return good;
+    }
+    // The PL022 divides clk_peri by an even number, 2 at the least
+    uint32_t clk = clock_get_hz(clk_peri);
+    for (uint div = clk / good; 2 < div;) {
+        div = (div - 1) & ~1u;
+        uint rate = clk / div;
+        if (rate > limit) {
+            break;
+        }
+        uint actual = sd_spi_set_frequency(pSD, rate);
+        if (actual <= good) {
+            continue;
+        }
+        int i = 0;
+        for (; i < SD_RAMP_READS; i++) {
+            if (0 != in_sd_read_blocks(pSD, check, 0, 1) ||
+                0 != memcmp(reference, check, sizeof check)) {
+                DBG_PRINTF("%s: reads fail at %u Hz\r\n", __FUNCTION__, actual);
+                break;
+            }
+        }
+        if (i < SD_RAMP_READS) {
+            break;
+        }
+        good = actual;
+    }
+    sd_spi_set_frequency(pSD, good);
+    DBG_PRINTF("%s: settled on %u Hz\r\n", __FUNCTION__, good);
+    return good;
+}
+
+#endif
+
 static int sd_init(sd_card_t *pSD);
 static bool sd_test_com(sd_card_t *pSD);
 
@@ -1137,6 +1516,8 @@ static void sd_ctor(sd_card_t *pSD) {
     pSD->init = sd_init;
     pSD->write_blocks = sd_write_blocks;
     pSD->read_blocks = sd_read_blocks;
+    pSD->read_blocks_async = sd_read_blocks_async;
+    pSD->read_blocks_poll = sd_read_blocks_poll;
     pSD->sd_test_com = sd_test_com;
 }
 bool sd_init_driver() {
@@ -1199,6 +1580,9 @@ static int sd_init(sd_card_t *pSD) {
     }
     // Initialize the member variables
     pSD->card_type = SDCARD_NONE;
+    pSD->high_speed = false;
+    pSD->baud_rate = 0;
+    pSD->au_sectors = 0;
 
     sd_spi_acquire(pSD);
 
@@ -1230,6 +1614,11 @@ static int sd_init(sd_card_t *pSD) {
     // The card is now initialized
     pSD->m_Status &= ~STA_NOINIT;
 
+#if SD_BAUD_RAMP
+    // Reads need the card marked initialized
+    pSD->baud_rate = sd_ramp_baud_rate(pSD);
+#endif
+
     sd_spi_release(pSD);
     sd_unlock(pSD);
 
@@ -32,6 +32,12 @@ extern "C" {
 
 typedef struct sd_card_t sd_card_t;
 
+// Bytes a batched command or start token read may clock in past what it needed
+#define SD_RX_AHEAD_SIZE 16
+
+// Completion hook for asynchronous reads; status is an SD_BLOCK_DEVICE_ERROR_* code.
+typedef void (*sd_read_done_cb_t)(sd_card_t *sd_card_p, int status, void *context);
+
 // "Class" representing SD Cards
 struct sd_card_t {
     const char *pcName;
@@ -54,6 +60,24 @@ struct sd_card_t {
     mutex_t mutex;
     FATFS fatfs;
     bool mounted;
+    bool high_speed;                                 // CMD6 switched the card to high speed timing
+    uint baud_rate;                                  // SCK the ramp in sd_init settled on, 0 before
+    uint32_t au_sectors;                             // Allocation unit from the SD status, 0 if unknown
+    uint32_t read_budget_us;                         // Time each async read started gets, 0 for no limit
+    uint32_t read_retries;                           // Async reads re-issued after a CRC error or lost token
+    uint32_t late_reads;                             // Async reads given up at their deadline
+
+    // Card output clocked in ahead of need by a batched read, handed out before
+    // anything new is clocked. Dropped when the host sends anything but fill.
+    uint8_t rx_ahead[SD_RX_AHEAD_SIZE];
+    uint8_t rx_ahead_pos, rx_ahead_len;
+
+    // Calls and total microseconds per command index (ACMDs count under theirs),
+    // from waiting for the card to be ready to the end of the response
+    struct {
+        uint32_t count;
+        uint32_t us;
+    } cmd_stats[64];
 
     int (*init)(sd_card_t *sd_card_p);
     int (*write_blocks)(sd_card_t *sd_card_p, const uint8_t *buffer,
@@ -61,6 +85,33 @@ struct sd_card_t {
     int (*read_blocks)(sd_card_t *sd_card_p, uint8_t *buffer, uint64_t ulSectorNumber,
                     uint32_t ulSectorCount);
 
+    // Non-blocking reads: start the transfer, then call read_blocks_poll until it
+    // stops returning SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK. The card stays selected
+    // (and its SPI locked) for the whole transfer. With read_budget_us set, blocks
+    // that fail are re-read while the budget lasts, and a read still going when it
+    // runs out ends with SD_BLOCK_DEVICE_ERROR_LATE instead of waiting on the card.
+    int (*read_blocks_async)(sd_card_t *sd_card_p, uint8_t *buffer, uint64_t ulSectorNumber,
+                    uint32_t ulSectorCount, sd_read_done_cb_t done_cb, void *context);
+    int (*read_blocks_poll)(sd_card_t *sd_card_p);
+
+    // State of the asynchronous read in progress, if any:
+    struct {
+        uint8_t *buffer;            // Where the next block lands
+        uint32_t blocks_left;
+        volatile uint32_t blocks_done;  // Blocks resident in the caller's buffer
+        bool multi;                 // CMD18 in use; needs CMD12 at the end
+        uint32_t run_blocks;        // Gathered reads: blocks per run, 0 for one contiguous buffer
+        uint32_t run_left;          // Blocks before the current run ends
+        uint32_t gap;               // Bytes skipped in the buffer between runs
+        uint64_t sector;            // Card block the read started at
+        absolute_time_t deadline;   // Every wait gives up here, nil_time for no deadline
+        uint32_t retries_left;
+        bool active;
+        int status;                 // Result of the last finished read
+        sd_read_done_cb_t done_cb;
+        void *context;
+    } async;
+
     // Useful when use_card_detect is false - call periodically to check for presence of SD card
     // Returns true if and only if SD card was sensed on the bus
     bool (*sd_test_com)(sd_card_t *sd_card_p);
@@ -78,6 +129,7 @@ struct sd_card_t {
 #define SD_BLOCK_DEVICE_ERROR_CRC -5009    /*!< CRC error */
 #define SD_BLOCK_DEVICE_ERROR_ERASE -5010 /*!< Erase error: reset/sequence */
 #define SD_BLOCK_DEVICE_ERROR_WRITE -5011 /*!< SPI Write error: !SPI_DATA_ACCEPTED */
+#define SD_BLOCK_DEVICE_ERROR_LATE -5012  /*!< async read ran past its deadline */
 
 ///* Disk Status Bits (DSTATUS) */
 // See diskio.h.
@@ -90,6 +142,13 @@ struct sd_card_t {
 bool sd_card_detect(sd_card_t *pSD);
 uint64_t sd_sectors(sd_card_t *pSD);
 
+// Like read_blocks_async, but the blocks land in runs of run_blocks with gap
+// bytes left alone between runs, the first run being first_run blocks long.
+// Lets two cards fill alternate stripes of one buffer.
+int sd_read_blocks_async_strided(sd_card_t *pSD, uint8_t *buffer, uint64_t ulSectorNumber,
+                                 uint32_t ulSectorCount, uint32_t first_run, uint32_t run_blocks,
+                                 uint32_t gap);
+
 bool sd_init_driver();
 bool sd_card_detect(sd_card_t *sd_card_p);
 
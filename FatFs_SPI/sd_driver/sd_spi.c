@@ -31,9 +31,16 @@ specific language governing permissions and limitations under the License.
 #pragma GCC diagnostic ignored "-Wunused-variable"
 
 void sd_spi_go_high_frequency(sd_card_t *pSD) {
-    uint actual = spi_set_baudrate(pSD->spi->hw_inst, pSD->spi->baud_rate);
+    // Once sd_init has ramped the clock, stay at the rate it settled on
+    uint baud_rate = pSD->baud_rate ? pSD->baud_rate : pSD->spi->baud_rate;
+    uint actual = spi_set_baudrate(pSD->spi->hw_inst, baud_rate);
     TRACE_PRINTF("%s: Actual frequency: %lu\n", __FUNCTION__, (long)actual);
 }
+uint sd_spi_set_frequency(sd_card_t *pSD, uint baud_rate) {
+    uint actual = spi_set_baudrate(pSD->spi->hw_inst, baud_rate);
+    TRACE_PRINTF("%s: Actual frequency: %lu\n", __FUNCTION__, (long)actual);
+    return actual;
+}
 void sd_spi_go_low_frequency(sd_card_t *pSD) {
     uint actual = spi_set_baudrate(pSD->spi->hw_inst, 400 * 1000); // Actual frequency: 398089
     TRACE_PRINTF("%s: Actual frequency: %lu\n", __FUNCTION__, (long)actual);
@@ -50,6 +57,7 @@ static void sd_spi_unlock(sd_card_t *pSD) {
 
 // Would do nothing if pSD->ss_gpio were set to GPIO_FUNC_SPI.
 static void sd_spi_select(sd_card_t *pSD) {
+    pSD->rx_ahead_len = 0;
     gpio_put(pSD->ss_gpio, 0);
     // A fill byte seems to be necessary, sometimes:
     uint8_t fill = SPI_FILL_CHAR;
@@ -58,6 +66,7 @@ static void sd_spi_select(sd_card_t *pSD) {
 }
 
 static void sd_spi_deselect(sd_card_t *pSD) {
+    pSD->rx_ahead_len = 0;
     gpio_put(pSD->ss_gpio, 1);
     LED_OFF();
     /*
@@ -88,11 +97,43 @@ void sd_spi_release(sd_card_t *pSD) {
 
 bool sd_spi_transfer(sd_card_t *pSD, const uint8_t *tx, uint8_t *rx,
                      size_t length) {
+    if (tx || !rx) {
+        // The card has moved on; whatever was read ahead is stale
+        pSD->rx_ahead_len = 0;
+    } else {
+        size_t ahead = sd_spi_take_ahead(pSD, rx, length);
+        rx += ahead;
+        length -= ahead;
+        if (!length) return true;
+    }
     return spi_transfer(pSD->spi, tx, rx, length);
 }
 
+void sd_spi_keep_ahead(sd_card_t *pSD, const uint8_t *rx, size_t length) {
+    myASSERT(length <= SD_RX_AHEAD_SIZE);
+    memcpy(pSD->rx_ahead, rx, length);
+    pSD->rx_ahead_pos = 0;
+    pSD->rx_ahead_len = length;
+}
+
+size_t sd_spi_take_ahead(sd_card_t *pSD, uint8_t *rx, size_t length) {
+    size_t n = pSD->rx_ahead_len;
+    if (n > length) n = length;
+    memcpy(rx, pSD->rx_ahead + pSD->rx_ahead_pos, n);
+    pSD->rx_ahead_pos += n;
+    pSD->rx_ahead_len -= n;
+    return n;
+}
+
 uint8_t sd_spi_write(sd_card_t *pSD, const uint8_t value) {
     // TRACE_PRINTF("%s\n", __FUNCTION__);
+    if (pSD->rx_ahead_len) {
+        if (SPI_FILL_CHAR == value) {
+            pSD->rx_ahead_len--;
+            return pSD->rx_ahead[pSD->rx_ahead_pos++];
+        }
+        pSD->rx_ahead_len = 0;
+    }
     uint8_t received = SPI_FILL_CHAR;
 #if 0
     int num = spi_write_read_blocking(pSD->spi->hw_inst, &value, &received, 1);
@@ -19,14 +19,23 @@ specific language governing permissions and limitations under the License.
 #include "sd_card.h"
 
 /* Transfer tx to SPI while receiving SPI to rx. 
-tx or rx can be NULL if not important. */
+tx or rx can be NULL if not important. 
+A pure read (tx NULL) starts with any bytes that were read ahead. */
 bool sd_spi_transfer(sd_card_t *pSD, const uint8_t *tx, uint8_t *rx, size_t length);
 uint8_t sd_spi_write(sd_card_t *pSD, const uint8_t value);
+/* Keep bytes a batched read clocked in past what it needed,
+sd_spi_write and sd_spi_transfer hand them out before clocking any more. */
+void sd_spi_keep_ahead(sd_card_t *pSD, const uint8_t *rx, size_t length);
+/* Move up to length read ahead bytes to rx, returns how many. */
+size_t sd_spi_take_ahead(sd_card_t *pSD, uint8_t *rx, size_t length);
 void sd_spi_deselect_pulse(sd_card_t *pSD);
 void sd_spi_acquire(sd_card_t *pSD);
 void sd_spi_release(sd_card_t *pSD);
 void sd_spi_go_low_frequency(sd_card_t *this);
 void sd_spi_go_high_frequency(sd_card_t *this);
+/* Sets SCK as close to baud_rate as the divider allows, without going over.
+Returns the actual frequency. */
+uint sd_spi_set_frequency(sd_card_t *pSD, uint baud_rate);
 
 /* 
 After power up, the host starts the clock and sends the initializing sequence on the CMD line. 
@@ -15,6 +15,7 @@ specific language governing permissions and limitations under the License.
 #include <assert.h>
 #include <stdbool.h>
 //
+#include "hardware/sync.h"
 #include "pico/stdlib.h"
 #include "pico/mutex.h"
 #include "pico/sem.h"
@@ -38,6 +39,8 @@ static void in_spi_irq_handler(const uint DMA_IRQ_num, io_rw_32 *dma_hw_ints_p)
                 assert(!sem_available(&spi_p->sem));
                 bool ok = sem_release(&spi_p->sem);
                 assert(ok);
+                if (spi_p->xfer_done_cb)
+                    spi_p->xfer_done_cb(spi_p->xfer_done_ctx);
             }
         }
     }
@@ -54,15 +57,28 @@ void set_spi_dma_irq_channel(bool useChannel1, bool shared) {
     irqShared = shared;
 }
 
-// SPI Transfer: Read & Write (simultaneously) on SPI bus
+void spi_set_transfer_callback(spi_t *spi_p, void (*cb)(void *context), void *context) {
+    spi_p->xfer_done_cb = NULL;  // Never leave a half-updated hook visible to the ISR
+    spi_p->xfer_done_ctx = context;
+    spi_p->xfer_done_cb = cb;
+}
+
+// The one DMA sniffer, lent to a single SPI transfer at a time
+static spi_t *sniffer_owner;
+
+// Start an SPI transfer and return without waiting for it.
+//   The DMA moves the data in the background; reap it with
+//   spi_transfer_is_complete() or spi_transfer_wait_complete() before
+//   touching the buffers or starting another transfer on this SPI.
 //   If the data that will be received is not important, pass NULL as rx.
 //   If the data that will be transmitted is not important,
 //     pass NULL as tx and then the SPI_FILL_CHAR is sent out as each data
 //     element.
-bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
+bool spi_transfer_start(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
     // assert(512 == length || 1 == length);
     assert(tx || rx);
     // assert(!(tx && rx));
+    assert(!spi_p->xfer_pending);
 
     // tx write increment is already false
     if (tx) {
@@ -106,20 +122,40 @@ bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
             assert(false);
     }
     sem_reset(&spi_p->sem, 0);
+    spi_p->xfer_pending = true;
+    spi_p->sniffing = false;
+    spi_p->rx_crc_valid = false;
 
     // start them exactly simultaneously to avoid races (in extreme cases
     // the FIFO could overflow)
     dma_start_channel_mask((1u << spi_p->tx_dma) | (1u << spi_p->rx_dma));
+    return true;
+}
 
-    /* Wait until master completes transfer or time out has occured. */
-    uint32_t timeOut = 1000; /* Timeout 1 sec */
-    bool rc = sem_acquire_timeout_ms(
-        &spi_p->sem, timeOut);  // Wait for notification from ISR
-    if (!rc) {
-        // If the timeout is reached the function will return false
-        DBG_PRINTF("Notification wait timed out in %s\n", __FUNCTION__);
-        return false;
+// Like spi_transfer_start() for a read (fill chars out, data into rx), but the
+//   DMA sniffer runs CRC16-CCITT over the received bytes as they land, starting
+//   from seed. Once the transfer is reaped, rx_crc_valid says whether it was
+//   sniffed and rx_crc has the result. The sniffer is shared by all channels;
+//   if another SPI has it, the read goes ahead unsniffed and the caller has to
+//   check the data itself.
+bool spi_transfer_start_crc(spi_t *spi_p, uint8_t *rx, size_t length, uint16_t seed) {
+    uint32_t save = save_and_disable_interrupts();
+    bool sniff = !sniffer_owner;
+    if (sniff) sniffer_owner = spi_p;
+    restore_interrupts(save);
+    if (!sniff) {
+        return spi_transfer_start(spi_p, NULL, rx, length);
     }
+    dma_sniffer_enable(spi_p->rx_dma, DMA_SNIFF_CTRL_CALC_VALUE_CRC16, false);
+    dma_sniffer_set_data_accumulator(seed);
+    channel_config_set_sniff_enable(&spi_p->rx_dma_cfg, true);
+    bool ok = spi_transfer_start(spi_p, NULL, rx, length);
+    channel_config_set_sniff_enable(&spi_p->rx_dma_cfg, false);
+    spi_p->sniffing = true;
+    return ok;
+}
+
+static void spi_transfer_finish(spi_t *spi_p) {
     // Shouldn't be necessary:
     dma_channel_wait_for_finish_blocking(spi_p->tx_dma);
     dma_channel_wait_for_finish_blocking(spi_p->rx_dma);
@@ -128,9 +164,118 @@ bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
     assert(!dma_channel_is_busy(spi_p->tx_dma));
     assert(!dma_channel_is_busy(spi_p->rx_dma));
 
+    if (spi_p->sniffing) {
+        spi_p->rx_crc = dma_sniffer_get_data_accumulator();
+        spi_p->rx_crc_valid = true;
+        dma_sniffer_disable();
+        spi_p->sniffing = false;
+        sniffer_owner = NULL;
+    }
+    spi_p->xfer_pending = false;
+}
+
+// Non-blocking check for the end of a transfer started by spi_transfer_start().
+//   Returns true once the transfer has completed (or if none is pending).
+bool spi_transfer_is_complete(spi_t *spi_p) {
+    if (!spi_p->xfer_pending) return true;
+    if (!sem_try_acquire(&spi_p->sem)) return false;
+    spi_transfer_finish(spi_p);
     return true;
 }
 
+// Block until a transfer started by spi_transfer_start() completes.
+//   Returns false if the timeout is reached first.
+bool spi_transfer_wait_complete(spi_t *spi_p, uint32_t timeout_ms) {
+    if (!spi_p->xfer_pending) return true;
+
+    /* Wait until master completes transfer or time out has occured. */
+    bool rc = sem_acquire_timeout_ms(
+        &spi_p->sem, timeout_ms);  // Wait for notification from ISR
+    if (!rc) {
+        // If the timeout is reached the function will return false
+        DBG_PRINTF("Notification wait timed out in %s\n", __FUNCTION__);
+        if (spi_p->sniffing) {
+            dma_sniffer_disable();
+            spi_p->sniffing = false;
+            sniffer_owner = NULL;
+        }
+        spi_p->xfer_pending = false;
+        return false;
+    }
+    spi_transfer_finish(spi_p);
+    return true;
+}
+
+// Transfer by feeding and draining the FIFOs from the CPU. For a few bytes
+//   this beats setting up two DMA channels, taking the IRQ and going through
+//   the semaphore, which costs more than the bytes themselves take on the wire.
+static bool __not_in_flash_func(spi_transfer_polled)(spi_t *spi_p, const uint8_t *tx, uint8_t *rx,
+                                                     size_t length) {
+    assert(!spi_p->xfer_pending);
+    spi_hw_t *hw = spi_get_hw(spi_p->hw_inst);
+    size_t tx_left = length, rx_left = length;
+    while (rx_left) {
+        // Never more than a FIFO's worth in flight, or the receive FIFO could overflow
+        if (tx_left && rx_left - tx_left < SPI_FIFO_DEPTH && (hw->sr & SPI_SSPSR_TNF_BITS)) {
+            hw->dr = tx ? *tx++ : SPI_FILL_CHAR;
+            --tx_left;
+        }
+        if (hw->sr & SPI_SSPSR_RNE_BITS) {
+            uint8_t received = (uint8_t)hw->dr;
+            if (rx) *rx++ = received;
+            --rx_left;
+        }
+    }
+    spi_p->rx_crc_valid = false;
+    return true;
+}
+
+static bool spi_transfer_dma(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
+    spi_transfer_start(spi_p, tx, rx, length);
+
+    uint32_t timeOut = 1000; /* Timeout 1 sec */
+    return spi_transfer_wait_complete(spi_p, timeOut);
+}
+
+// SPI Transfer: Read & Write (simultaneously) on SPI bus
+//   If the data that will be received is not important, pass NULL as rx.
+//   If the data that will be transmitted is not important,
+//     pass NULL as tx and then the SPI_FILL_CHAR is sent out as each data
+//     element.
+//   Transfers of up to poll_max bytes are polled, longer ones go by DMA.
+bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
+    if (length <= spi_p->poll_max) {
+        return spi_transfer_polled(spi_p, tx, rx, length);
+    }
+    return spi_transfer_dma(spi_p, tx, rx, length);
+}
+
+// Time polled and DMA transfers of fill chars, 1 to max_length bytes long,
+//   and return the longest length at which polling is still as fast as DMA
+//   (0 if DMA always wins). Nanoseconds per transfer go into polled_ns and
+//   dma_ns, if given, indexed by length - 1. Only fill chars are clocked, so
+//   call it with the SPI locked and every card on it deselected.
+size_t spi_measure_poll_crossover(spi_t *spi_p, size_t max_length, uint32_t *polled_ns,
+                                  uint32_t *dma_ns) {
+    uint8_t rx[SPI_POLL_MEASURE_MAX];
+    if (max_length > sizeof rx) max_length = sizeof rx;
+    size_t crossover = 0;
+    for (size_t length = 1; length <= max_length; ++length) {
+        uint32_t start = time_us_32();
+        for (size_t i = 0; i < SPI_POLL_MEASURE_ROUNDS; ++i)
+            spi_transfer_polled(spi_p, NULL, rx, length);
+        uint32_t polled = (time_us_32() - start) * 1000 / SPI_POLL_MEASURE_ROUNDS;
+        start = time_us_32();
+        for (size_t i = 0; i < SPI_POLL_MEASURE_ROUNDS; ++i)
+            spi_transfer_dma(spi_p, NULL, rx, length);
+        uint32_t dma = (time_us_32() - start) * 1000 / SPI_POLL_MEASURE_ROUNDS;
+        if (polled_ns) polled_ns[length - 1] = polled;
+        if (dma_ns) dma_ns[length - 1] = dma;
+        if (polled <= dma) crossover = length;
+    }
+    return crossover;
+}
+
 void spi_lock(spi_t *spi_p) {
     assert(mutex_is_initialized(&spi_p->mutex));
     mutex_enter_blocking(&spi_p->mutex);
@@ -153,6 +298,8 @@ bool my_spi_init(spi_t *spi_p) {
         // Default:
         if (!spi_p->baud_rate)
             spi_p->baud_rate = 10 * 1000 * 1000;
+        if (!spi_p->poll_max)
+            spi_p->poll_max = SPI_POLL_MAX;
         // For the IRQ notification:
         sem_init(&spi_p->sem, 0, 1);
 
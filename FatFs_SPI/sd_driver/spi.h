@@ -26,6 +26,16 @@ specific language governing permissions and limitations under the License.
 #include "pico/types.h"
 
 #define SPI_FILL_CHAR (0xFF)
+#define SPI_FIFO_DEPTH 8
+
+// Blocking transfers up to this long are polled rather than done by DMA.
+// Commands (with their response window) and token hunts fit; data blocks don't.
+// spi_measure_poll_crossover() finds where DMA starts to win on the hardware.
+#ifndef SPI_POLL_MAX
+#define SPI_POLL_MAX 32
+#endif
+#define SPI_POLL_MEASURE_MAX 64
+#define SPI_POLL_MEASURE_ROUNDS 64
 
 // "Class" representing SPIs
 typedef struct {
@@ -36,6 +46,7 @@ typedef struct {
     uint sck_gpio;
     uint baud_rate;
     uint DMA_IRQ_num; // DMA_IRQ_0 or DMA_IRQ_1
+    size_t poll_max;  // spi_transfer() polls up to this many bytes; SPI_POLL_MAX if left 0
 
     // Drive strength levels for GPIO outputs.
     // enum gpio_drive_strength { GPIO_DRIVE_STRENGTH_2MA = 0, GPIO_DRIVE_STRENGTH_4MA = 1, GPIO_DRIVE_STRENGTH_8MA = 2,
@@ -53,6 +64,15 @@ typedef struct {
     bool initialized;  
     semaphore_t sem;
     mutex_t mutex;    
+    bool xfer_pending;  // A transfer was started and not yet reaped
+    bool sniffing;      // The transfer in flight runs its received data through the DMA sniffer
+    bool rx_crc_valid;  // The last transfer reaped was sniffed, rx_crc is its CRC16
+    uint16_t rx_crc;
+
+    // Optional completion hook for asynchronous transfers.
+    // Runs in DMA IRQ context, so keep it short. Polled transfers don't call it.
+    void (*xfer_done_cb)(void *context);
+    void *xfer_done_ctx;
 } spi_t;
 
 #ifdef __cplusplus
@@ -60,10 +80,16 @@ extern "C" {
 #endif
   
 bool __not_in_flash_func(spi_transfer)(spi_t *pSPI, const uint8_t *tx, uint8_t *rx, size_t length);  
+bool spi_transfer_start(spi_t *pSPI, const uint8_t *tx, uint8_t *rx, size_t length);
+bool spi_transfer_start_crc(spi_t *pSPI, uint8_t *rx, size_t length, uint16_t seed);
+bool spi_transfer_is_complete(spi_t *pSPI);
+bool spi_transfer_wait_complete(spi_t *pSPI, uint32_t timeout_ms);
+void spi_set_transfer_callback(spi_t *pSPI, void (*cb)(void *context), void *context);
 void spi_lock(spi_t *pSPI);
 void spi_unlock(spi_t *pSPI);
 bool my_spi_init(spi_t *pSPI);
 void set_spi_dma_irq_channel(bool useChannel1, bool shared);
+size_t spi_measure_poll_crossover(spi_t *pSPI, size_t max_length, uint32_t *polled_ns, uint32_t *dma_ns);
 
 #ifdef __cplusplus
 }
@@ -62,6 +62,7 @@ const char *FRESULT_str(FRESULT i) {
     }
 }
 
+#if !FF_FS_READONLY
 FRESULT delete_node (
     TCHAR* path,    /* Path name buffer with the sub-directory to delete */
     UINT sz_buff,   /* Size of path name buffer (items) */
@@ -103,3 +104,36 @@ FRESULT delete_node (
     if (fr == FR_OK) fr = f_unlink(path);  /* Delete the empty sub-directory */
     return fr;
 }
+#endif
+
+#if FF_USE_FASTSEEK
+/* Map a file offset to the physical sector holding it, for callers that
+   want to move file data with disk_read/disk_read_async themselves.
+   Needs a cluster link map (fp->cltbl, see f_lseek(CREATE_LINKMAP)).
+   *run receives the number of physically contiguous sectors from there
+   up to the end of the fragment. */
+FRESULT f_file_sector(FIL *fp, FSIZE_t ofs, LBA_t *sector, UINT *run) {
+    FATFS *fs = fp->obj.fs;
+    if (!fp->cltbl || !fs) return FR_INVALID_PARAMETER;
+    if (ofs >= fp->obj.objsize) return FR_INVALID_PARAMETER;
+
+    DWORD sect_in_file = (DWORD)(ofs / FF_MAX_SS);
+    DWORD cl = sect_in_file / fs->csize;  /* Cluster order from top of the file */
+    DWORD *tbl = fp->cltbl + 1;
+    DWORD ncl;
+    for (;;) {
+        ncl = *tbl++;  /* Number of clusters in the fragment */
+        if (ncl == 0) return FR_INT_ERR;  /* End of table */
+        if (cl < ncl) break;
+        cl -= ncl;
+        tbl++;
+    }
+    DWORD clst = cl + *tbl;
+    if (clst < 2 || clst >= fs->n_fatent) return FR_INT_ERR;
+
+    DWORD sect_in_clst = sect_in_file % fs->csize;
+    *sector = fs->database + (LBA_t)fs->csize * (clst - 2) + sect_in_clst;
+    if (run) *run = (UINT)((ncl - cl) * fs->csize - sect_in_clst);
+    return FR_OK;
+}
+#endif
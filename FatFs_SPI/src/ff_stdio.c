@@ -123,6 +123,7 @@ int ff_fclose(FF_FILE *pxStream) {
     else
         return -1;
 }
+#if FF_FS_MINIMIZE < 1
 // Populates an ff_stat_struct with information about a file.
 int ff_stat(const char *pcFileName, FF_Stat_t *pxStatBuffer) {
     TRACE_PRINTF("%s\n", __func__);
@@ -142,6 +143,8 @@ int ff_stat(const char *pcFileName, FF_Stat_t *pxStatBuffer) {
     else
         return -1;
 }
+#endif
+#if !FF_FS_READONLY
 size_t ff_fwrite(const void *pvBuffer, size_t xSize, size_t xItems,
                  FF_FILE *pxStream) {
     TRACE_PRINTF("%s\n", __func__);
@@ -159,6 +162,7 @@ size_t ff_fwrite(const void *pvBuffer, size_t xSize, size_t xItems,
     errno = fresult2errno(fr);
     return bw / xSize;
 }
+#endif
 size_t ff_fread(void *pvBuffer, size_t xSize, size_t xItems,
                 FF_FILE *pxStream) {
     TRACE_PRINTF("%s\n", __func__);
@@ -175,6 +179,7 @@ size_t ff_fread(void *pvBuffer, size_t xSize, size_t xItems,
     errno = fresult2errno(fr);
     return br / xSize;
 }
+#if FF_FS_RPATH >= 1
 int ff_chdir(const char *pcDirectoryName) {
     TRACE_PRINTF("%s\n", __func__);
     // FRESULT f_chdir (
@@ -189,6 +194,8 @@ int ff_chdir(const char *pcDirectoryName) {
     else
         return -1;
 }
+#endif
+#if FF_FS_RPATH >= 2
 char *ff_getcwd(char *pcBuffer, size_t xBufferLength) {
     TRACE_PRINTF("%s\n", __func__);
     // FRESULT f_getcwd (
@@ -217,6 +224,8 @@ char *ff_getcwd(char *pcBuffer, size_t xBufferLength) {
         return NULL;
     }
 }
+#endif
+#if !FF_FS_READONLY
 int ff_mkdir(const char *pcDirectoryName) {
     TRACE_PRINTF("%s(pxStream=%s)\n", __func__, pcDirectoryName);
     FRESULT fr = f_mkdir(pcDirectoryName);
@@ -253,6 +262,7 @@ int ff_fputc(int iChar, FF_FILE *pxStream) {
         return -1;
     }
 }
+#endif
 int ff_fgetc(FF_FILE *pxStream) {
     // TRACE_PRINTF("%s(pxStream=%p)\n", __func__, pxStream);
     // FRESULT f_read (
@@ -275,6 +285,7 @@ int ff_fgetc(FF_FILE *pxStream) {
     else
         return FF_EOF;
 }
+#if !FF_FS_READONLY
 int ff_rmdir(const char *pcDirectory) {
     TRACE_PRINTF("%s\n", __func__);
     // FRESULT f_unlink (
@@ -299,6 +310,7 @@ int ff_remove(const char *pcPath) {
     else
         return -1;
 }
+#endif
 long ff_ftell(FF_FILE *pxStream) {
     TRACE_PRINTF("%s\n", __func__);
     // FSIZE_t f_tell (
@@ -333,6 +345,7 @@ int ff_fseek(FF_FILE *pxStream, int iOffset, int iWhence) {
     else
         return -1;
 }
+#if FF_USE_FIND && FF_FS_RPATH >= 2
 int ff_findfirst(const char *pcDirectory, FF_FindData_t *pxFindData) {
     TRACE_PRINTF("%s(%s)\n", __func__, pcDirectory);
     // FRESULT f_findfirst (
@@ -369,6 +382,8 @@ int ff_findfirst(const char *pcDirectory, FF_FindData_t *pxFindData) {
     else
         return -1;
 }
+#endif
+#if FF_USE_FIND
 int ff_findnext(FF_FindData_t *pxFindData) {
     TRACE_PRINTF("%s\n", __func__);
     // FRESULT f_findnext (
@@ -387,6 +402,8 @@ int ff_findnext(FF_FindData_t *pxFindData) {
         return -1;
     }
 }
+#endif
+#if !FF_FS_READONLY
 FF_FILE *ff_truncate(const char *pcFileName, long lTruncateSize) {
     TRACE_PRINTF("%s\n", __func__);
     FIL *fp = malloc(sizeof(FIL));
@@ -449,6 +466,8 @@ int ff_rename(const char *pcOldName, const char *pcNewName,
     else
         return -1;
 }
+#endif
+#if FF_USE_STRFUNC
 char *ff_fgets(char *pcBuffer, size_t xCount, FF_FILE *pxStream) {
     TRACE_PRINTF("%s\n", __func__);
     TCHAR *p = f_gets(pcBuffer, xCount, pxStream);
@@ -461,3 +480,4 @@ char *ff_fgets(char *pcBuffer, size_t xCount, FF_FILE *pxStream) {
         return NULL;
     }
 }
+#endif
@@ -20,10 +20,13 @@ specific language governing permissions and limitations under the License.
 /* storage control modules to the FatFs module with a defined API.       */
 /*-----------------------------------------------------------------------*/
 #include <stdio.h>
+#include <string.h>
 //
 #include "ff.h" /* Obtains integer types */
 //
 #include "diskio.h" /* Declarations of disk functions */
+#include "diskio_async.h"
+#include "diskio_cache.h"
 //
 #include "hw_config.h"
 #include "my_debug.h"
@@ -32,6 +35,127 @@ specific language governing permissions and limitations under the License.
 #define TRACE_PRINTF(fmt, args...)
 //#define TRACE_PRINTF printf  // task_printf
 
+/*-----------------------------------------------------------------------*/
+/* Sector cache                                                          */
+/*-----------------------------------------------------------------------*/
+/* Single sector reads (FatFs's win buffer: FAT and directory entries, the
+ * unaligned heads and tails of f_read) go through a small cache. A miss on
+ * the sector after the previous one fetches DISK_CACHE_AHEAD sectors in one
+ * multi-block read. FAT sectors get their own slots, so read-ahead data
+ * never pushes them out. */
+
+#if DISK_CACHE_AHEAD
+
+typedef struct {
+    bool valid;
+    BYTE pdrv;
+    LBA_t sector;  // First sector in data
+    UINT count;
+    BYTE data[DISK_CACHE_AHEAD][FF_MAX_SS];
+} cache_run_t;
+
+typedef struct {
+    bool valid;
+    BYTE pdrv;
+    LBA_t sector;
+    uint32_t used;  // cache_clock at the last hit, the oldest slot goes first
+    BYTE data[FF_MAX_SS];
+} cache_slot_t;
+
+static cache_run_t ahead_run;
+static cache_slot_t fat_slots[DISK_CACHE_FAT];
+static uint32_t cache_clock;
+static LBA_t next_sector[FF_VOLUMES];  // Sector a sequential reader asks for next
+
+volatile uint32_t disk_cache_hits;
+volatile uint32_t disk_cache_misses;
+
+static bool is_fat_sector(sd_card_t *p_sd, LBA_t sector) {
+    FATFS *fs = &p_sd->fatfs;
+    return fs->fs_type && sector >= fs->fatbase &&
+           sector < fs->fatbase + (LBA_t)fs->fsize * fs->n_fats;
+}
+
+static BYTE *cache_find(BYTE pdrv, LBA_t sector) {
+    if (ahead_run.valid && pdrv == ahead_run.pdrv && sector >= ahead_run.sector &&
+        sector < ahead_run.sector + ahead_run.count) {
+        return ahead_run.data[sector - ahead_run.sector];
+    }
+    for (size_t i = 0; i < DISK_CACHE_FAT; ++i) {
+        cache_slot_t *slot = &fat_slots[i];
+        if (slot->valid && pdrv == slot->pdrv && sector == slot->sector) {
+            slot->used = ++cache_clock;
+            return slot->data;
+        }
+    }
+    return NULL;
+}
+
+static void cache_invalidate(BYTE pdrv) {
+    if (pdrv == ahead_run.pdrv) ahead_run.valid = false;
+    for (size_t i = 0; i < DISK_CACHE_FAT; ++i) {
+        if (pdrv == fat_slots[i].pdrv) fat_slots[i].valid = false;
+    }
+}
+
+// Keep cached copies in step with what is written to the card
+static void cache_update(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count) {
+    for (UINT i = 0; i < count; ++i) {
+        BYTE *cached = cache_find(pdrv, sector + i);
+        if (cached) memcpy(cached, buff + i * FF_MAX_SS, FF_MAX_SS);
+    }
+}
+
+static int cache_read(sd_card_t *p_sd, BYTE pdrv, BYTE *buff, LBA_t sector) {
+    BYTE *cached = cache_find(pdrv, sector);
+    bool fat = is_fat_sector(p_sd, sector);
+    // Following a cluster chain mustn't break up the data stream
+    bool sequential = !fat && sector == next_sector[pdrv];
+    if (!fat) next_sector[pdrv] = sector + 1;
+    if (cached) {
+        disk_cache_hits++;
+        memcpy(buff, cached, FF_MAX_SS);
+        return SD_BLOCK_DEVICE_ERROR_NONE;
+    }
+    disk_cache_misses++;
+
+    if (fat) {
+        cache_slot_t *slot = &fat_slots[0];
+        for (size_t i = 1; i < DISK_CACHE_FAT; ++i) {
+            if (!fat_slots[i].valid || fat_slots[i].used < slot->used) slot = &fat_slots[i];
+        }
+        slot->valid = false;
+        int rc = p_sd->read_blocks(p_sd, slot->data, sector, 1);
+        if (SD_BLOCK_DEVICE_ERROR_NONE != rc) return rc;
+        slot->pdrv = pdrv;
+        slot->sector = sector;
+        slot->used = ++cache_clock;
+        slot->valid = true;
+        memcpy(buff, slot->data, FF_MAX_SS);
+        return rc;
+    }
+
+    UINT count = 1;
+    if (sequential) {
+        // Streaming: bring in the next few sectors with the same command
+        count = DISK_CACHE_AHEAD;
+        if (sector < p_sd->sectors && sector + count > p_sd->sectors) {
+            count = p_sd->sectors - sector;
+        }
+    }
+    ahead_run.valid = false;
+    int rc = p_sd->read_blocks(p_sd, ahead_run.data[0], sector, count);
+    if (SD_BLOCK_DEVICE_ERROR_NONE != rc) return rc;
+    ahead_run.pdrv = pdrv;
+    ahead_run.sector = sector;
+    ahead_run.count = count;
+    ahead_run.valid = true;
+    memcpy(buff, ahead_run.data[0], FF_MAX_SS);
+    return rc;
+}
+
+#endif
+
 /*-----------------------------------------------------------------------*/
 /* Get Drive Status                                                      */
 /*-----------------------------------------------------------------------*/
@@ -59,6 +183,10 @@ DSTATUS disk_initialize(
 
     sd_card_t *p_sd = sd_get_by_num(pdrv);
     if (!p_sd) return RES_PARERR;
+#if DISK_CACHE_AHEAD
+    // It may be a different card
+    if (p_sd->m_Status & STA_NOINIT) cache_invalidate(pdrv);
+#endif
     // See http://elm-chan.org/fsw/ff/doc/dstat.html
     return p_sd->init(p_sd);  
 }
@@ -77,6 +205,8 @@ static int sdrc2dresult(int sd_rc) {
             return RES_PARERR;
         case SD_BLOCK_DEVICE_ERROR_WRITE_PROTECTED:
             return RES_WRPRT;
+        case SD_BLOCK_DEVICE_ERROR_LATE:
+            return RES_LATE;
         case SD_BLOCK_DEVICE_ERROR_CRC:
         case SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK:
         case SD_BLOCK_DEVICE_ERROR_ERASE:
@@ -98,10 +228,69 @@ DRESULT disk_read(BYTE pdrv,  /* Physical drive nmuber to identify the drive */
     TRACE_PRINTF(">>> %s\n", __FUNCTION__);
     sd_card_t *p_sd = sd_get_by_num(pdrv);
     if (!p_sd) return RES_PARERR;
+#if DISK_CACHE_AHEAD
+    if (1 == count && pdrv < FF_VOLUMES) {
+        return sdrc2dresult(cache_read(p_sd, pdrv, buff, sector));
+    }
+    // Longer reads go straight to the caller's buffer; a single sector
+    // right after one is the reader carrying on
+    if (pdrv < FF_VOLUMES) next_sector[pdrv] = sector + count;
+#endif
     int rc = p_sd->read_blocks(p_sd, buff, sector, count);
     return sdrc2dresult(rc);
 }
 
+/*-----------------------------------------------------------------------*/
+/* Read Sector(s) without blocking                                       */
+/*-----------------------------------------------------------------------*/
+
+void disk_read_budget(BYTE pdrv, UINT budget_us) {
+    sd_card_t *p_sd = sd_get_by_num(pdrv);
+    if (p_sd) p_sd->read_budget_us = budget_us;
+}
+
+DRESULT disk_read_async(BYTE pdrv,  /* Physical drive nmuber to identify the drive */
+                        BYTE *buff, /* Data buffer to store read data */
+                        LBA_t sector, /* Start sector in LBA */
+                        UINT count    /* Number of sectors to read */
+) {
+    TRACE_PRINTF(">>> %s\n", __FUNCTION__);
+    sd_card_t *p_sd = sd_get_by_num(pdrv);
+    if (!p_sd) return RES_PARERR;
+    int rc = p_sd->read_blocks_async(p_sd, buff, sector, count, NULL, NULL);
+    return sdrc2dresult(rc);
+}
+
+DRESULT disk_read_async_strided(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count,
+                                UINT first_run, UINT run, UINT gap) {
+    TRACE_PRINTF(">>> %s\n", __FUNCTION__);
+    sd_card_t *p_sd = sd_get_by_num(pdrv);
+    if (!p_sd) return RES_PARERR;
+    int rc = sd_read_blocks_async_strided(p_sd, buff, sector, count, first_run, run, gap);
+    return sdrc2dresult(rc);
+}
+
+bool disk_read_poll(BYTE pdrv, DRESULT *result, UINT *sectors_done) {
+    sd_card_t *p_sd = sd_get_by_num(pdrv);
+    if (!p_sd) {
+        *result = RES_PARERR;
+        return true;
+    }
+    int rc = p_sd->read_blocks_poll(p_sd);
+    if (sectors_done) *sectors_done = p_sd->async.blocks_done;
+    if (SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK == rc) return false;
+    *result = sdrc2dresult(rc);
+    return true;
+}
+
+DRESULT disk_read_wait(BYTE pdrv) {
+    DRESULT res;
+    while (!disk_read_poll(pdrv, &res, NULL)) {
+        tight_loop_contents();
+    }
+    return res;
+}
+
 /*-----------------------------------------------------------------------*/
 /* Write Sector(s)                                                       */
 /*-----------------------------------------------------------------------*/
@@ -117,6 +306,13 @@ DRESULT disk_write(BYTE pdrv, /* Physical drive nmuber to identify the drive */
     sd_card_t *p_sd = sd_get_by_num(pdrv);
     if (!p_sd) return RES_PARERR;
     int rc = p_sd->write_blocks(p_sd, buff, sector, count);
+#if DISK_CACHE_AHEAD
+    if (SD_BLOCK_DEVICE_ERROR_NONE == rc) {
+        cache_update(pdrv, buff, sector, count);
+    } else {
+        cache_invalidate(pdrv);  // No telling what reached the card
+    }
+#endif
     return sdrc2dresult(rc);
 }
 
@@ -156,7 +352,12 @@ DRESULT disk_ioctl(BYTE pdrv, /* Physical drive nmuber (0..) */
                                 // f_mkfs function and it attempts to align data
                                 // area on the erase block boundary. It is
                                 // required when FF_USE_MKFS == 1.
-            static DWORD bs = 1;
+            // The card's allocation unit, when it gave one. The odd sizes
+            // (12, 24 MB) go down to the largest power of 2 they are a
+            // multiple of.
+            DWORD bs = p_sd->au_sectors ? p_sd->au_sectors : 1;
+            bs &= ~bs + 1;  // Lowest bit set
+            if (bs > 32768) bs = 32768;
             *(DWORD *)buff = bs;
             return RES_OK;
         }
@@ -0,0 +1,320 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ff.h"
+#include "cardBenchmark.h"
+#include "frameDecoding.h"
+#include "playerConfig.h"
+
+#define SECTOR_SIZE 512
+
+BenchmarkResult benchmarkResults[5]; // block sequential, block strided, file sequential, frames, mounts. for the debugger
+uint32_t smallReadNs; // FatFs's own time per f_read
+#if !FF_FS_READONLY
+FIL resultsFile;
+#endif
+bool resultsFileOpen = false;
+
+void benchmarkReport(const char* format, ...) {
+    char line[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    printf("%s", line);
+#if !FF_FS_READONLY
+    if (resultsFileOpen) {
+        f_puts(line, &resultsFile);
+    }
+#endif
+}
+
+void closeResults() {
+#if !FF_FS_READONLY
+    if (resultsFileOpen) {
+        f_close(&resultsFile);
+    }
+#endif
+    resultsFileOpen = false;
+}
+
+void startResult(BenchmarkResult* result, const char* name) {
+    memset(result, 0, sizeof(*result));
+    result->name = name;
+    result->minUs = UINT32_MAX;
+}
+
+void recordRead(BenchmarkResult* result, uint32_t bytes, uint64_t us, bool ok) {
+    if (!ok) {
+        result->errors++;
+        return;
+    }
+    if (us > UINT32_MAX) {
+        us = UINT32_MAX;
+    }
+    result->reads++;
+    result->bytes += bytes;
+    result->totalUs += us;
+    if (us < result->minUs) {
+        result->minUs = us;
+    }
+    if (us > result->maxUs) {
+        result->maxUs = us;
+    }
+    if (us > BENCHMARK_FRAME_TIME_US) {
+        result->late++;
+    }
+    int bucket = 0;
+    while (BENCHMARK_HISTOGRAM_BUCKETS - 1 > bucket && us >= (2ull << bucket)) {
+        bucket++;
+    }
+    result->histogram[bucket]++;
+}
+
+// How long it takes for all but the slowest (1000 - perMille) / 1000 of the reads, to the histogram's precision.
+uint32_t latencyBound(const BenchmarkResult* result, uint32_t perMille) {
+    uint32_t wanted = (result->reads * perMille + 999) / 1000;
+    uint32_t seen = 0;
+    for (int i = 0; BENCHMARK_HISTOGRAM_BUCKETS > i; i++) {
+        seen += result->histogram[i];
+        if (seen >= wanted && (2u << i) < result->maxUs) {
+            return 2u << i;
+        } else if (seen >= wanted) {
+            break;
+        }
+    }
+    return result->maxUs;
+}
+
+void reportResult(const BenchmarkResult* result) {
+    if (0 == result->reads) {
+        benchmarkReport("%s: nothing read, %u errors\n", result->name, result->errors);
+        return;
+    }
+    uint32_t kbPerSecond = result->totalUs ? result->bytes * 1000000 / result->totalUs / 1024 : 0;
+    if (result->bytes) {
+        benchmarkReport("%s: %u reads of %u bytes on average, %u KB/s, %u errors\n", result->name, result->reads,
+               (unsigned)(result->bytes / result->reads), kbPerSecond, result->errors);
+    } else {
+        benchmarkReport("%s: %u, %u errors\n", result->name, result->reads, result->errors);
+    }
+    benchmarkReport("  latency %u us min, %u average, %u max, 99%% under %u, %u over a frame time\n", result->minUs,
+           (unsigned)(result->totalUs / result->reads), result->maxUs, latencyBound(result, 990), result->late);
+    for (int i = 0; BENCHMARK_HISTOGRAM_BUCKETS > i; i++) {
+        if (result->histogram[i] && BENCHMARK_HISTOGRAM_BUCKETS - 1 == i) {
+            benchmarkReport("  %8u us and up %6u\n", 1u << i, result->histogram[i]);
+        } else if (result->histogram[i]) {
+            benchmarkReport("  %8u-%8u us %6u\n", 1u << i, (2u << i) - 1, result->histogram[i]);
+        }
+    }
+}
+
+// Long reads through the card's block reads, going on from start.
+void benchmarkBlocksSequential(const BenchmarkCard* card, uint64_t start, uint8_t* buffer, BenchmarkResult* result) {
+    startResult(result, "block reads, sequential");
+    uint64_t sector = start;
+    for (uint32_t i = 0; BENCHMARK_SEQUENTIAL_BYTES / (BENCHMARK_RUN_SECTORS * SECTOR_SIZE) > i; i++) {
+        if (sector + BENCHMARK_RUN_SECTORS > card->sectors) {
+            sector = 0;
+        }
+        uint64_t startTime = card->now();
+        int status = card->readBlocks(card->card, buffer, sector, BENCHMARK_RUN_SECTORS);
+        recordRead(result, BENCHMARK_RUN_SECTORS * SECTOR_SIZE, card->now() - startTime, 0 == status);
+        sector += BENCHMARK_RUN_SECTORS;
+    }
+}
+
+// Short reads spread over the whole card, each somewhere the card hasn't just been.
+void benchmarkBlocksStrided(const BenchmarkCard* card, uint8_t* buffer, BenchmarkResult* result) {
+    startResult(result, "block reads, strided");
+    uint64_t stride = card->sectors / BENCHMARK_STRIDED_READS;
+    if (card->auSectors && stride > card->auSectors) {
+        stride -= stride % card->auSectors; // lands on the same place in every allocation unit
+    }
+    stride &= ~(uint64_t)(BENCHMARK_STRIDED_SECTORS - 1);
+    if (stride < BENCHMARK_STRIDED_SECTORS) {
+        stride = BENCHMARK_STRIDED_SECTORS;
+    }
+    uint64_t sector = 0;
+    for (uint32_t i = 0; BENCHMARK_STRIDED_READS > i && sector + BENCHMARK_STRIDED_SECTORS <= card->sectors; i++) {
+        uint64_t startTime = card->now();
+        int status = card->readBlocks(card->card, buffer, sector, BENCHMARK_STRIDED_SECTORS);
+        recordRead(result, BENCHMARK_STRIDED_SECTORS * SECTOR_SIZE, card->now() - startTime, 0 == status);
+        sector += stride;
+    }
+}
+
+// The video read straight through with f_read.
+void benchmarkFileSequential(const BenchmarkCard* card, FIL* video, uint8_t* buffer, BenchmarkResult* result) {
+    startResult(result, "file reads, sequential");
+    f_lseek(video, 0);
+    for (uint32_t i = 0; BENCHMARK_SEQUENTIAL_BYTES / (BENCHMARK_RUN_SECTORS * SECTOR_SIZE) > i; i++) {
+        UINT bytesRead = 0;
+        uint64_t startTime = card->now();
+        FRESULT res = f_read(video, buffer, BENCHMARK_RUN_SECTORS * SECTOR_SIZE, &bytesRead);
+        recordRead(result, bytesRead, card->now() - startTime, FR_OK == res);
+        if (FR_OK == res && BENCHMARK_RUN_SECTORS * SECTOR_SIZE != bytesRead) {
+            break; // end of the file
+        }
+    }
+}
+
+// Whole frames of the video, read as the player does them: the frame's header, then the rest of it
+// (in pieces when it's bigger than the buffer). Goes back to the first frame if the video runs out.
+// Returns the largest frame it read.
+uint32_t benchmarkFrames(const BenchmarkCard* card, FIL* video, uint32_t numFrames, uint32_t firstFrame, uint32_t flags,
+                         uint8_t* buffer, uint32_t bufferSize, BenchmarkResult* result) {
+    startResult(result, "file reads, frames");
+    uint32_t largest = 0;
+    FSIZE_t pos = firstFrame;
+    uint32_t frame = 0;
+    for (uint32_t i = 0; BENCHMARK_FRAMES > i && numFrames; i++) {
+        if (numFrames == frame) {
+            pos = firstFrame;
+            frame = 0;
+        }
+        uint64_t startTime = card->now();
+        uint32_t header[4];
+        UINT bytesRead = 0;
+        FRESULT res = f_lseek(video, pos);
+        if (FR_OK == res) {
+            res = f_read(video, header, sizeof(header), &bytesRead);
+        }
+        if (FR_OK != res || sizeof(header) != bytesRead || header[3] < sizeof(header)) {
+            recordRead(result, 0, 0, false);
+            break; // corrupt, or off the end of the file
+        }
+        uint32_t frameLength = header[3];
+        for (uint32_t left = frameLength - sizeof(header); left && FR_OK == res; left -= bytesRead) {
+            res = f_read(video, buffer, left < bufferSize ? left : bufferSize, &bytesRead);
+            if (0 == bytesRead) {
+                res = FR_INT_ERR; // the file ends part way through the frame
+            }
+        }
+        recordRead(result, frameLength, card->now() - startTime, FR_OK == res);
+        if (frameLength > largest) {
+            largest = frameLength;
+        }
+
+        pos += (flags & CRV_FLAG_SECTOR_ALIGNED) ? (frameLength + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1) : frameLength;
+        frame++;
+    }
+    return largest;
+}
+
+// Unmounts and mounts the volume again. The card has been started already, so this is FatFs reading
+// its way in, through the sector cache in the glue.
+void benchmarkMounts(const BenchmarkCard* card, BenchmarkResult* result) {
+    startResult(result, "mounts");
+    for (int i = 0; BENCHMARK_MOUNTS > i; i++) {
+        f_mount(NULL, card->drive, 0);
+        uint64_t startTime = card->now();
+        FRESULT res = f_mount(card->fs, card->drive, 1);
+        recordRead(result, 0, card->now() - startTime, FR_OK == res);
+    }
+}
+
+// Nanoseconds per f_read of a few bytes the file already has in its buffer: no card traffic, all FatFs.
+uint32_t benchmarkSmallReads(const BenchmarkCard* card, FIL* video) {
+    uint8_t bytes[16];
+    UINT bytesRead;
+    f_lseek(video, 0);
+    f_read(video, bytes, sizeof(bytes), &bytesRead); // loads the sector
+    uint64_t startTime = card->now();
+    for (int i = 0; BENCHMARK_SMALL_READS > i; i++) {
+        f_lseek(video, 0);
+        f_read(video, bytes, sizeof(bytes), &bytesRead);
+    }
+    return (card->now() - startTime) * 1000 / BENCHMARK_SMALL_READS;
+}
+
+bool runCardBenchmark(const BenchmarkCard* card, const char* videoName, uint8_t* buffer, uint32_t bufferSize) {
+    if (BENCHMARK_RUN_SECTORS * SECTOR_SIZE > bufferSize) {
+        printf("Card benchmark needs a buffer of %u bytes, not %u\n", BENCHMARK_RUN_SECTORS * SECTOR_SIZE, bufferSize);
+        return false;
+    }
+    // before anything is open, remounting closes it all
+    benchmarkMounts(card, &benchmarkResults[4]);
+
+#if !FF_FS_READONLY
+    resultsFileOpen = FR_OK == f_open(&resultsFile, BENCHMARK_RESULTS_FILE, FA_CREATE_ALWAYS | FA_WRITE);
+#endif
+    if (!resultsFileOpen) {
+        printf("Can't write %s, results only go to the console\n", BENCHMARK_RESULTS_FILE);
+    }
+    benchmarkReport("Card benchmark: %u MB, allocation unit %u KB, against %s at %u us a frame\n",
+           (unsigned)(card->sectors / 2048), card->auSectors / 2, videoName, BENCHMARK_FRAME_TIME_US);
+    if (card->reportDriver) {
+        card->reportDriver(card->card);
+    }
+    if (card->bootMountUs) {
+        benchmarkReport("mount at power on: %u us, starting the card included\n", card->bootMountUs);
+    }
+    reportResult(&benchmarkResults[4]);
+
+    // the video's header, for its frames and what they need
+    FIL video;
+    unsigned char header[0x14] = {0};
+    UINT headerLength = 0;
+    FRESULT res = f_open(&video, videoName, FA_READ);
+    if (FR_OK == res) {
+        res = f_read(&video, header, sizeof(header), &headerLength);
+    }
+    if (FR_OK != res || 8 > headerLength || 0 != memcmp(header, "CRV", 3)) {
+        benchmarkReport("Can't read %s as a .crv (FatFs error %d)\n", videoName, res);
+        closeResults();
+        memset(buffer, 0, bufferSize);
+        return false;
+    }
+    uint32_t numFrames, firstFrame = 0x8, maxFrameLength = 0, flags = 0;
+    memcpy(&numFrames, header + 0x4, 4);
+    if (header[3] >= 1) {
+        memcpy(&firstFrame, header + 0x8, 4);
+        memcpy(&maxFrameLength, header + 0xC, 4);
+        if (firstFrame >= 0x14) {
+            memcpy(&flags, header + 0x10, 4);
+        }
+    }
+    FATFS* fs = video.obj.fs;
+    uint64_t videoSector = video.obj.sclust >= 2 ? fs->database + (uint64_t)fs->csize * (video.obj.sclust - 2) : 0;
+
+    smallReadNs = benchmarkSmallReads(card, &video);
+    benchmarkReport("f_read of 16 bytes already in the file's buffer: %u ns\n", smallReadNs);
+
+    benchmarkBlocksSequential(card, videoSector, buffer, &benchmarkResults[0]);
+    reportResult(&benchmarkResults[0]);
+    benchmarkBlocksStrided(card, buffer, &benchmarkResults[1]);
+    reportResult(&benchmarkResults[1]);
+    benchmarkFileSequential(card, &video, buffer, &benchmarkResults[2]);
+    reportResult(&benchmarkResults[2]);
+    uint32_t largestRead = benchmarkFrames(card, &video, numFrames, firstFrame, flags, buffer, bufferSize, &benchmarkResults[3]);
+    reportResult(&benchmarkResults[3]);
+
+    // what the video needs: its average frame every frame time, and room for its largest
+    const BenchmarkResult* frames = &benchmarkResults[3];
+    uint32_t averageFrame = numFrames ? (f_size(&video) - firstFrame) / numFrames : 0;
+    if (0 == maxFrameLength) {
+        maxFrameLength = largestRead; // older files don't say, so go by the frames read
+    }
+    benchmarkReport("%s: %u frames, %u bytes on average, needs %u KB/s (%u KB/s for its largest frame, %u bytes)\n", videoName,
+           numFrames, averageFrame, (unsigned)((uint64_t)averageFrame * 1000000 / BENCHMARK_FRAME_TIME_US / 1024),
+           (unsigned)((uint64_t)maxFrameLength * 1000000 / BENCHMARK_FRAME_TIME_US / 1024), maxFrameLength);
+
+    bool fastEnough = frames->reads && 0 == frames->errors && frames->totalUs / frames->reads <= BENCHMARK_FRAME_TIME_US;
+    uint32_t averageUs = frames->reads ? frames->totalUs / frames->reads : 0;
+    if (!fastEnough) {
+        benchmarkReport("FAIL: frames take %u us on average, the video can't keep up on this card\n", averageUs);
+    } else if (frames->late * 100 > frames->reads) {
+        benchmarkReport("MARGINAL: %u of %u frames took more than a frame time and would be dropped\n", frames->late, frames->reads);
+    } else {
+        benchmarkReport("PASS: frames take %u us on average, %u.%u times as fast as needed\n", averageUs,
+               BENCHMARK_FRAME_TIME_US / (averageUs ? averageUs : 1),
+               BENCHMARK_FRAME_TIME_US * 10 / (averageUs ? averageUs : 1) % 10);
+    }
+
+    f_close(&video);
+    closeResults();
+    memset(buffer, 0, bufferSize);
+    return fastEnough;
+}
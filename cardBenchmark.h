@@ -0,0 +1,47 @@
+#ifndef CARD_BENCHMARK_INCLUDED
+#define CARD_BENCHMARK_INCLUDED
+
+#include <stdint.h>
+
+#include "ff.h"
+
+// Card qualification: sequential, strided and frame-sized reads timed through the card's block reads
+// and through FatFs, with a latency histogram each, checked against what a video needs. Runs on the
+// player in benchmark mode (see main.cpp) and on the host against an emulated card (tools/cardImage).
+
+#define BENCHMARK_HISTOGRAM_BUCKETS 21 // bucket i counts reads of 2^i to 2^(i+1) us, the last one anything longer
+
+// The card as the benchmark sees it.
+typedef struct {
+    void* card;
+    FATFS* fs; // the volume on it, mounted as drive
+    const char* drive;
+    uint32_t bootMountUs; // how long the first mount took (starting the card included), 0 if not known
+    int (*readBlocks)(void* card, uint8_t* buffer, uint64_t sector, uint32_t count); // 0 on success
+    uint64_t sectors;
+    uint32_t auSectors; // 0 if unknown
+    uint64_t (*now)(); // microseconds
+    void (*reportDriver)(void* card); // adds what only the driver can measure to the results, may be NULL
+} BenchmarkCard;
+
+typedef struct {
+    const char* name;
+    uint32_t reads;
+    uint32_t errors;
+    uint32_t late; // reads that took longer than a frame time
+    uint64_t bytes;
+    uint64_t totalUs;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint32_t histogram[BENCHMARK_HISTOGRAM_BUCKETS];
+} BenchmarkResult;
+
+// Runs every benchmark on the card and writes the results to BENCHMARK_RESULTS_FILE on it (unless FatFs
+// is built read-only) as well as printing them. videoName is the .crv the card is checked against. buffer is scratch space of bufferSize bytes, at least BENCHMARK_RUN_SECTORS sectors,
+// and is zeroed when done. Returns false if the card isn't fast enough for the video, or the video couldn't be read.
+bool runCardBenchmark(const BenchmarkCard* card, const char* videoName, uint8_t* buffer, uint32_t bufferSize);
+
+// Prints a line of the results, and writes it to the results file while the benchmark has it open.
+void benchmarkReport(const char* format, ...);
+
+#endif // CARD_BENCHMARK_INCLUDED
@@ -0,0 +1,52 @@
+// FlashSource, apart from the other sources as it needs the XIP and DMA hardware.
+#include "frameSource.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/regs/addressmap.h"
+#include "hardware/structs/xip_ctrl.h"
+#include <string.h>
+
+extern char __flash_binary_end; // from the linker script
+
+FlashSource::FlashSource(uint32_t flashOffset) : flashOffset(flashOffset), dmaChannel(-1) {}
+
+bool FlashSource::open(const char* name) {
+    if ((uintptr_t)&__flash_binary_end > XIP_BASE + flashOffset) {
+        panic("Firmware runs into the video at flash offset 0x%x\n", flashOffset);
+    }
+    if (dmaChannel < 0) {
+        dmaChannel = dma_claim_unused_channel(true);
+    }
+    return true;
+}
+
+UINT FlashSource::read(void* dst, uint32_t ofs, UINT len) {
+    memcpy(dst, (const void*)(XIP_NOCACHE_NOALLOC_BASE + flashOffset + ofs), len); // uncached view for headers
+    return len;
+}
+
+unsigned char* FlashSource::fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz) {
+    // streamed in by DMA through the XIP stream FIFO, which goes around the XIP cache so playing
+    // doesn't evict the code. The stream moves whole words, so it starts at the word holding ofs.
+    unsigned char* dst = buf + ofs % SECTOR_SIZE;
+    uint32_t lead = ofs & 3;
+    uint32_t words = (lead + len + 3) / 4;
+    uint32_t* out = (uint32_t*)(dst - lead);
+    while (!(xip_ctrl_hw->stat & XIP_STAT_FIFO_EMPTY)) {
+        (void)xip_ctrl_hw->stream_fifo; // nothing should be left over, but a stale word would shift everything
+    }
+    xip_ctrl_hw->stream_addr = XIP_BASE + flashOffset + ofs - lead;
+    xip_ctrl_hw->stream_ctr = words;
+
+    dma_channel_config config = dma_channel_get_default_config(dmaChannel);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_dreq(&config, DREQ_XIP_STREAM);
+    dma_channel_configure(dmaChannel, &config, out, (const void*)XIP_AUX_BASE, words, true);
+    while (dma_channel_is_busy(dmaChannel)) {
+        if (lz) {
+            lzDecode(lz, (unsigned char*)(out + words - dma_hw->ch[dmaChannel].transfer_count));
+        }
+    }
+    return dst;
+}
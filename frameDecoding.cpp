@@ -0,0 +1,155 @@
+#include "frameDecoding.h"
+#include "videoFileReading.h"
+#include <string.h>
+
+void expandBursts(const unsigned char* src, unsigned char* dst, uint32_t bursts, int valueBits, const unsigned char* palette) {
+    int pairBits = 5 + valueBits;
+    uint32_t valueMask = (1 << valueBits) - 1;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (uint32_t i = 0; bursts > i; i++) {
+        uint32_t values[4];
+        for (int j = 0; 4 > j; j++) {
+            while (bits < pairBits) {
+                acc |= (uint32_t)*src++ << bits; // least significant bit first
+                bits += 8;
+            }
+            dst[2 * j] = ((acc & 0x1F) + 0x10) << 1;
+            values[j] = (acc >> 5) & valueMask;
+            acc >>= pairBits;
+            bits -= pairBits;
+        }
+
+        if (PACKED_HOLD_CMD == dst[0]) {
+            // slot count is spread over the values, lowest bits first
+            uint32_t slots = values[0] | (values[1] << valueBits) | (values[2] << (2 * valueBits));
+            dst[0] = HOLD_BURST;
+            dst[1] = 0;
+            dst[2] = slots;
+            dst[3] = slots >> 8;
+            for (int j = 4; 8 > j; j++) {
+                dst[j] = 0;
+            }
+        } else if (palette) {
+            for (int j = 0; 4 > j; j++) {
+                dst[2 * j + 1] = palette[values[j]];
+            }
+        } else {
+            for (int j = 0; 4 > j; j++) {
+                dst[2 * j + 1] = values[j];
+            }
+        }
+        dst += 8;
+    }
+}
+
+int32_t decodeDeltaGroup(const unsigned char* src, uint32_t srcLength, const unsigned char* ref, uint32_t refBursts,
+                         unsigned char* dst, uint32_t maxBursts, bool packed) {
+    uint32_t pos = 0;
+    uint32_t bursts = 0;
+    while (pos + 4 <= srcLength) {
+        uint32_t copies = src[pos] | (src[pos + 1] << 8);
+        uint32_t literals = src[pos + 2] | (src[pos + 3] << 8);
+        pos += 4;
+        if (bursts + copies > refBursts || bursts + copies + literals > maxBursts) {
+            return -1;
+        }
+
+        // copied bursts sit at the same position in the reference
+        memcpy(dst + bursts * 8, ref + bursts * 8, copies * 8);
+        bursts += copies;
+
+        if (packed) {
+            expandBursts(src + pos, dst + bursts * 8, literals, 8, NULL);
+            pos += (literals * 52 + 7) / 8;
+        } else {
+            memmove(dst + bursts * 8, src + pos, literals * 8);
+            pos += literals * 8;
+        }
+        bursts += literals;
+    }
+    return bursts;
+}
+
+void lzBegin(LzDecoder* lz, const unsigned char* src, uint32_t srcLength, unsigned char* dst, uint32_t dstLength) {
+    lz->inStart = src;
+    lz->in = src;
+    lz->inEnd = src + srcLength;
+    lz->out = dst;
+    lz->outStart = dst;
+    lz->outEnd = dst + dstLength;
+}
+
+// Reads an LZ4 length extension (bytes added on until one isn't 255). Returns false if it runs past end.
+static bool lzLength(const unsigned char** p, const unsigned char* end, uint32_t* length) {
+    uint32_t b;
+    do {
+        if (*p >= end) {
+            return false;
+        }
+        b = *(*p)++;
+        *length += b;
+    } while (255 == b);
+    return true;
+}
+
+int lzDecode(LzDecoder* lz, const unsigned char* available) {
+    if (available > lz->inEnd) {
+        available = lz->inEnd;
+    }
+
+    while (lz->in < available) {
+        // the sequence is only taken once all of it has arrived, so a partial one waits for the next call
+        const unsigned char* p = lz->in;
+        uint32_t token = *p++;
+        uint32_t literals = token >> 4;
+        if (15 == literals && !lzLength(&p, available, &literals)) {
+            return 0;
+        }
+        if ((uint32_t)(available - p) < literals) {
+            return 0;
+        }
+        const unsigned char* literalStart = p;
+        p += literals;
+
+        if (p == lz->inEnd) {
+            // the last sequence is only literals
+            if ((uint32_t)(lz->outEnd - lz->out) != literals) {
+                return -1;
+            }
+            memmove(lz->out, literalStart, literals);
+            lz->out += literals;
+            lz->in = p;
+            return 1;
+        }
+
+        if (available - p < 2) {
+            return 0;
+        }
+        uint32_t offset = p[0] | (p[1] << 8);
+        p += 2;
+        uint32_t matchLength = token & 0xF;
+        if (15 == matchLength && !lzLength(&p, available, &matchLength)) {
+            return 0;
+        }
+        matchLength += 4;
+
+        if ((uint32_t)(lz->outEnd - lz->out) < literals + matchLength) {
+            return -1;
+        }
+        memmove(lz->out, literalStart, literals);
+        lz->out += literals;
+        if (0 == offset || (uint32_t)(lz->out - lz->outStart) < offset) {
+            return -1;
+        }
+
+        // byte by byte, matches may overlap what they're writing
+        const unsigned char* match = lz->out - offset;
+        for (uint32_t i = 0; matchLength > i; i++) {
+            lz->out[i] = match[i];
+        }
+        lz->out += matchLength;
+        lz->in = p;
+    }
+    return lz->in == lz->inEnd && lz->out == lz->outEnd ? 1 : 0;
+}
@@ -0,0 +1,51 @@
+#ifndef FRAME_DECODING_INCLUDED
+#define FRAME_DECODING_INCLUDED
+
+#include <stdint.h>
+
+// .crv file header flags, see docs/fileFormat.md
+#define CRV_FLAG_HOLD_BURSTS 0x1 // groups may contain hold bursts, group headers count slots
+#define CRV_FLAG_PACKED_BURSTS 0x2 // bursts are stored as four 13-bit (channel, value) pairs
+#define CRV_FLAG_FRAME_ENCODING 0x4 // every frame header carries an encoding at 0x10
+#define CRV_FLAG_DELTA_FRAMES 0x8 // some frames are deltas against the frame two back
+#define CRV_FLAG_LZ_FRAMES 0x10 // some frames are LZ compressed
+#define CRV_FLAG_SECTOR_ALIGNED 0x20 // every frame starts on a 512-byte boundary of the file
+#define CRV_FLAG_CONTIGUOUS 0x40 // the file was written to the card as one run of sectors (tools/cardImage)
+
+// frame encodings
+#define FRAME_RAW 0 // bursts as the file flags say
+#define FRAME_PALETTE 1 // value palette after the frame header, bursts as four 10-bit (channel, index) pairs
+#define FRAME_DELTA 2 // groups are runs copied from the frame two back or stored as they are
+#define FRAME_LZ 3 // raw groups compressed as one LZ4 block after the expanded frame length
+
+#define FRAME_PALETTE_BITS 5
+#define FRAME_PALETTE_SIZE (1 << FRAME_PALETTE_BITS)
+#define PACKED_HOLD_CMD ((31 + 0x10) << 1) // channel 31 doesn't exist, a packed hold unpacks to this
+
+// Expands bursts stored as four (5-bit channel, valueBits value) pairs into ready-to-send ones.
+// Values are looked up in the palette when there is one. dst may overlap src as long as it stays behind it.
+void expandBursts(const unsigned char* src, unsigned char* dst, uint32_t bursts, int valueBits, const unsigned char* palette);
+
+// Rebuilds a delta-coded group from the same group of the reference frame. Literal bursts are packed
+// when packed is set. Returns the number of bursts written, or -1 if the runs don't fit the reference
+// or would write more than maxBursts. dst may overlap src as long as it stays behind it.
+int32_t decodeDeltaGroup(const unsigned char* src, uint32_t srcLength, const unsigned char* ref, uint32_t refBursts,
+                         unsigned char* dst, uint32_t maxBursts, bool packed);
+
+// Decoder for an LZ4 block that can be fed as the block arrives, one whole sequence at a time.
+typedef struct {
+    const unsigned char* inStart;
+    const unsigned char* in;
+    const unsigned char* inEnd;
+    unsigned char* out;
+    unsigned char* outStart;
+    unsigned char* outEnd;
+} LzDecoder;
+
+void lzBegin(LzDecoder* lz, const unsigned char* src, uint32_t srcLength, unsigned char* dst, uint32_t dstLength);
+
+// Decodes every sequence that lies wholly before available. Returns 1 once the block is done, 0 if it
+// needs more input, or -1 if the block is corrupt. dst may overlap src as long as it stays behind it.
+int lzDecode(LzDecoder* lz, const unsigned char* available);
+
+#endif // FRAME_DECODING_INCLUDED
@@ -0,0 +1,312 @@
+#include "frameSource.h"
+#include "f_util.h"
+#include "diskio_async.h"
+#include "pico/stdlib.h"
+#include <string.h>
+
+// Waits for a sector read started with disk_read_async, feeding lz each sector as it lands so
+// decompressing keeps up with the read.
+static DRESULT waitForSectors(BYTE pdrv, unsigned char* out, LzDecoder* lz) {
+    DRESULT result;
+    UINT done = 0;
+    UINT decoded = 0;
+    while (!disk_read_poll(pdrv, &result, &done)) {
+        if (lz && done > decoded) {
+            // decompressing what has landed while the next sectors are on the bus
+            lzDecode(lz, out + done * SECTOR_SIZE);
+            decoded = done;
+        }
+    }
+    return result;
+}
+
+UINT FrameSource::budgetLeft() {
+    if (0 == deadline) {
+        return 0;
+    }
+    int32_t left = deadline - time_us_32();
+    return left > 0 ? left : 1; // already past it, the read gets one go
+}
+
+bool SdFileSource::open(const char* name) {
+    FRESULT res = f_open(&fil, name, FA_READ);
+    if (FR_OK != res) {
+        return false;
+    }
+    filename = name;
+    for (int i = 0; 4 > i; i++) {
+        streamOpen[i] = false;
+    }
+
+    // mapping the file's clusters so frame bodies can skip f_read and be fetched without blocking
+    linkMap[0] = sizeof(linkMap) / sizeof(linkMap[0]);
+    fil.cltbl = linkMap;
+    rawSectorAccess = f_lseek(&fil, CREATE_LINKMAP) == FR_OK;
+    if (!rawSectorAccess) {
+        fil.cltbl = NULL; // too fragmented for the map, stick to f_read
+        printf("File too fragmented for sector access, using f_read\n");
+    }
+    contiguous = rawSectorAccess && 4 == linkMap[0]; // size, one fragment's length and start, terminator
+    return true;
+}
+
+void SdFileSource::close() {
+    for (int i = 0; 4 > i; i++) {
+        if (streamOpen[i]) {
+            f_close(&streamFils[i]);
+            streamOpen[i] = false;
+        }
+    }
+    f_close(&fil);
+}
+
+UINT SdFileSource::read(void* dst, uint32_t ofs, UINT len) {
+    UINT bytesRead = 0;
+    FRESULT res = f_lseek(&fil, ofs);
+    if (FR_OK == res) {
+        res = f_read(&fil, dst, len, &bytesRead);
+    }
+    if (FR_OK != res) {
+        // the caller sees a short read, and a frame header that doesn't come in costs just that frame
+        printf("f_read() error: %s (%d)\n", FRESULT_str(res), res);
+        return 0;
+    }
+    return bytesRead;
+}
+
+UINT SdFileSource::readStream(int stream, void* dst, uint32_t ofs, UINT len) {
+    FIL* streamFil = &streamFils[stream];
+    if (!streamOpen[stream]) {
+        FRESULT res = f_open(streamFil, filename, FA_READ);
+        if (FR_OK != res)
+            panic("f_open(%s) error: %s (%d)\n", filename, FRESULT_str(res), res);
+        streamFil->cltbl = fil.cltbl; // the map is only read once built, so it can be shared
+        streamOpen[stream] = true;
+    }
+
+    UINT bytesRead;
+    f_lseek(streamFil, ofs);
+    f_read(streamFil, dst, len, &bytesRead);
+    return bytesRead;
+}
+
+unsigned char* SdFileSource::fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz) {
+    unsigned char* dst = buf + ofs % SECTOR_SIZE;
+    UINT bytesRead;
+    if (rawSectorAccess) {
+        BYTE pdrv = fil.obj.fs->pdrv;
+        FSIZE_t pos = ofs - ofs % SECTOR_SIZE;
+        FSIZE_t end = ofs + len;
+        unsigned char* out = buf;
+        while (pos < end) {
+            LBA_t sector;
+            UINT run;
+            if (f_file_sector(&fil, pos, &sector, &run) != FR_OK) {
+                break;
+            }
+
+            // one multi-block transaction per contiguous run of the file
+            UINT count = (end - pos + SECTOR_SIZE - 1) / SECTOR_SIZE;
+            if (count > run) {
+                count = run;
+            }
+            disk_read_budget(pdrv, budgetLeft());
+            DRESULT res = disk_read_async(pdrv, out, sector, count);
+            if (RES_OK == res) {
+                res = waitForSectors(pdrv, out, lz);
+            }
+            if (RES_LATE == res) {
+                return NULL; // falling back to FatFs would be the very stall the deadline is there to stop
+            }
+            if (RES_OK != res) {
+                break;
+            }
+            pos += count * SECTOR_SIZE;
+            out += count * SECTOR_SIZE;
+        }
+
+        if (pos >= end) {
+            return dst;
+        }
+        // anything that went wrong gets a second chance through FatFs, if there is time left for one
+        if (deadline && (int32_t)(deadline - time_us_32()) <= 0) {
+            return NULL;
+        }
+        if (lz) {
+            // the reread lands on top of anything already decompressed, so start over
+            lzBegin(lz, lz->inStart, lz->inEnd - lz->inStart, lz->outStart, lz->outEnd - lz->outStart);
+        }
+    }
+
+    if (FR_OK != f_lseek(&fil, ofs) || FR_OK != f_read(&fil, dst, len, &bytesRead) || bytesRead != len) {
+        return NULL;
+    }
+    return dst;
+}
+
+RawSectorSource::RawSectorSource(BYTE pdrv, LBA_t firstSector) : pdrv(pdrv), firstSector(firstSector), bufferedSector((LBA_t)-1) {}
+
+bool RawSectorSource::open(const char* name) {
+    return 0 == (disk_initialize(pdrv) & STA_NOINIT); // no filesystem, so nothing has brought the card up yet
+}
+
+UINT RawSectorSource::read(void* dst, uint32_t ofs, UINT len) {
+    unsigned char* out = (unsigned char*)dst;
+    UINT left = len;
+    while (left > 0) {
+        LBA_t sector = firstSector + ofs / SECTOR_SIZE;
+        if (sector != bufferedSector) {
+            if (disk_read(pdrv, sectorBuf, sector, 1) != RES_OK) {
+                bufferedSector = (LBA_t)-1;
+                return len - left;
+            }
+            bufferedSector = sector;
+        }
+
+        UINT n = SECTOR_SIZE - ofs % SECTOR_SIZE;
+        if (n > left) {
+            n = left;
+        }
+        memcpy(out, sectorBuf + ofs % SECTOR_SIZE, n);
+        out += n;
+        ofs += n;
+        left -= n;
+    }
+    return len;
+}
+
+unsigned char* RawSectorSource::fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz) {
+    // the video is one contiguous run, so it's always a single multi-block transaction
+    UINT count = (ofs % SECTOR_SIZE + len + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    disk_read_budget(pdrv, budgetLeft());
+    if (disk_read_async(pdrv, buf, firstSector + ofs / SECTOR_SIZE, count) != RES_OK || waitForSectors(pdrv, buf, lz) != RES_OK) {
+        return NULL; // the driver has had its retries, so the frame goes
+    }
+    return buf + ofs % SECTOR_SIZE;
+}
+
+StripedSource::StripedSource(BYTE pdrv0, BYTE pdrv1, UINT stripeSectors) : stripeSectors(stripeSectors), bufferedSector((LBA_t)-1) {
+    pdrvs[0] = pdrv0;
+    pdrvs[1] = pdrv1;
+}
+
+bool StripedSource::open(const char* name) {
+    return 0 == (disk_initialize(pdrvs[0]) & STA_NOINIT) && 0 == (disk_initialize(pdrvs[1]) & STA_NOINIT);
+}
+
+UINT StripedSource::read(void* dst, uint32_t ofs, UINT len) {
+    unsigned char* out = (unsigned char*)dst;
+    UINT left = len;
+    while (left > 0) {
+        LBA_t sector = ofs / SECTOR_SIZE;
+        if (sector != bufferedSector) {
+            if (disk_read(pdrvs[cardOf(sector)], sectorBuf, cardSector(sector), 1) != RES_OK) {
+                bufferedSector = (LBA_t)-1;
+                return len - left;
+            }
+            bufferedSector = sector;
+        }
+
+        UINT n = SECTOR_SIZE - ofs % SECTOR_SIZE;
+        if (n > left) {
+            n = left;
+        }
+        memcpy(out, sectorBuf + ofs % SECTOR_SIZE, n);
+        out += n;
+        ofs += n;
+        left -= n;
+    }
+    return len;
+}
+
+// How many sectors at the front of the span starting at first have landed, given how many of its
+// sectors each card has read so far.
+UINT StripedSource::landed(LBA_t first, UINT count, const UINT done[2]) {
+    UINT used[2] = {0, 0};
+    LBA_t end = first + count;
+    for (LBA_t sector = first; sector < end;) {
+        LBA_t runEnd = (sector / stripeSectors + 1) * stripeSectors;
+        if (runEnd > end) {
+            runEnd = end;
+        }
+        int card = cardOf(sector);
+        if (used[card] + (runEnd - sector) > done[card]) {
+            return sector - first + done[card] - used[card];
+        }
+        used[card] += runEnd - sector;
+        sector = runEnd;
+    }
+    return count;
+}
+
+unsigned char* StripedSource::fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz) {
+    LBA_t first = ofs / SECTOR_SIZE;
+    LBA_t end = first + (ofs % SECTOR_SIZE + len + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+    // each card's share of the span is one run of its own sectors, a single multi-block transaction
+    // that drops them into every other stripe of buf
+    bool busy[2] = {false, false};
+    DRESULT results[2] = {RES_OK, RES_OK};
+    for (int card = 0; 2 > card; card++) {
+        LBA_t start = first;
+        if (cardOf(start) != card) {
+            start = (start / stripeSectors + 1) * stripeSectors;
+        }
+        if (start >= end) {
+            continue;
+        }
+        UINT count = 0;
+        for (LBA_t sector = start; sector < end; sector = (sector / stripeSectors + 2) * stripeSectors) {
+            LBA_t runEnd = (sector / stripeSectors + 1) * stripeSectors;
+            count += (runEnd < end ? runEnd : end) - sector;
+        }
+        UINT firstRun = (start / stripeSectors + 1) * stripeSectors - start;
+        disk_read_budget(pdrvs[card], budgetLeft());
+        results[card] = disk_read_async_strided(pdrvs[card], buf + (start - first) * SECTOR_SIZE, cardSector(start), count,
+                                                firstRun, stripeSectors, stripeSectors * SECTOR_SIZE);
+        busy[card] = RES_OK == results[card];
+    }
+
+    // both cards' DMA runs at once, decompressing whatever has landed in order meanwhile
+    UINT done[2] = {0, 0};
+    UINT decoded = 0;
+    while (busy[0] || busy[1]) {
+        for (int card = 0; 2 > card; card++) {
+            if (busy[card] && disk_read_poll(pdrvs[card], &results[card], &done[card])) {
+                busy[card] = false;
+            }
+        }
+        if (lz) {
+            UINT ready = landed(first, end - first, done);
+            if (ready > decoded) {
+                lzDecode(lz, buf + ready * SECTOR_SIZE);
+                decoded = ready;
+            }
+        }
+    }
+    if (results[0] != RES_OK || results[1] != RES_OK) {
+        return NULL; // the driver has had its retries, so the frame goes
+    }
+    return buf + ofs % SECTOR_SIZE;
+}
+
+RamSource::RamSource(const unsigned char* video, uint32_t length) : video(video), length(length) {}
+
+UINT RamSource::read(void* dst, uint32_t ofs, UINT len) {
+    if (ofs >= length) {
+        return 0;
+    }
+    if (len > length - ofs) {
+        len = length - ofs;
+    }
+    memcpy(dst, video + ofs, len);
+    return len;
+}
+
+unsigned char* RamSource::fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz) {
+    unsigned char* dst = buf + ofs % SECTOR_SIZE;
+    if (read(dst, ofs, len) != len) {
+        return NULL; // a frame that isn't all there
+    }
+    return dst;
+}
@@ -0,0 +1,138 @@
+#ifndef FRAME_SOURCE_INCLUDED
+#define FRAME_SOURCE_INCLUDED
+
+#include "ff.h"
+#include "frameDecoding.h"
+#include <stdio.h>
+
+#define SECTOR_SIZE 512
+
+// Where the reader gets a video's bytes from. Offsets are from the start of the video, so there is
+// no separate seek: every read says where it wants to be.
+class FrameSource {
+    protected:
+        uint32_t deadline; // time_us_32() by which fetch has to be done, 0 for none
+
+        // What's left until the deadline, for the driver. 0 when there is none.
+        UINT budgetLeft();
+
+    public:
+        FrameSource() : deadline(0) {}
+
+        // capability flags
+        const static uint32_t ASYNC = 0x1; // fetch leaves the CPU free while the data moves, LZ frames decode meanwhile
+        const static uint32_t SEEK_FREE = 0x2; // any offset is as quick to get to as the next one
+        const static uint32_t CONTIGUOUS = 0x4; // the video is one run on its medium, a fetch is one transaction
+
+        // Opens the named video (sources with only one video ignore the name). Returns false if it isn't there.
+        virtual bool open(const char* name) = 0;
+        virtual void close() {}
+
+        // Small reads, headers and the like. Returns how many bytes it got.
+        virtual UINT read(void* dst, uint32_t ofs, UINT len) = 0;
+
+        // Reads for one of a few independent streams (one per group in streaming playback), for sources
+        // where interleaved reads would get in each other's way.
+        virtual UINT readStream(int stream, void* dst, uint32_t ofs, UINT len) { return read(dst, ofs, len); }
+
+        // Reads a frame body of len bytes at ofs into buf, keeping its position within the sector (so buf
+        // needs a sector of slack on either side). Returns where the first byte landed. If lz is given (the
+        // reader only gives it to ASYNC sources), it may be fed the data as it lands; the caller finishes
+        // it off once the whole span is in.
+        // Returns NULL if the read failed or couldn't be done by the deadline.
+        virtual unsigned char* fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz) = 0;
+
+        // Sets the time_us_32() the fetches from now on have to finish by, 0 for no deadline. Sources
+        // that can't stall ignore it.
+        void setDeadline(uint32_t at) { deadline = at; }
+
+        virtual uint32_t capabilities() = 0;
+};
+
+// A file on the card through FatFs, with frame bodies read as raw sector runs when the file's
+// clusters fit the link map.
+class SdFileSource : public FrameSource {
+    private:
+        FIL fil;
+        FIL streamFils[4]; // opened on first use, each keeps its own sector cache
+        bool streamOpen[4];
+        const char* filename;
+        DWORD linkMap[64]; // cluster link map of the open file, lets frames be read sector by sector
+        bool rawSectorAccess;
+        bool contiguous; // the link map is a single fragment
+
+    public:
+        bool open(const char* name);
+        void close();
+        UINT read(void* dst, uint32_t ofs, UINT len);
+        UINT readStream(int stream, void* dst, uint32_t ofs, UINT len);
+        unsigned char* fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz);
+        uint32_t capabilities() { return (rawSectorAccess ? ASYNC : 0) | (contiguous ? CONTIGUOUS : 0); }
+};
+
+// A video written straight to the card's sectors from firstSector on, no filesystem.
+class RawSectorSource : public FrameSource {
+    private:
+        BYTE pdrv;
+        LBA_t firstSector;
+        unsigned char sectorBuf[SECTOR_SIZE]; // for reads that don't cover whole sectors
+        LBA_t bufferedSector;
+
+    public:
+        RawSectorSource(BYTE pdrv, LBA_t firstSector);
+        bool open(const char* name);
+        UINT read(void* dst, uint32_t ofs, UINT len);
+        unsigned char* fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz);
+        uint32_t capabilities() { return ASYNC | CONTIGUOUS; }
+};
+
+// A video striped over the raw sectors of two cards from sector 0, stripeSectors on one card then
+// stripeSectors on the other. Frame bodies are read from both at once, each card on its own SPI.
+class StripedSource : public FrameSource {
+    private:
+        BYTE pdrvs[2];
+        UINT stripeSectors;
+        unsigned char sectorBuf[SECTOR_SIZE]; // for reads that don't cover whole sectors
+        LBA_t bufferedSector; // sector of the video, not of a card
+
+        int cardOf(LBA_t sector) { return sector / stripeSectors % 2; }
+        LBA_t cardSector(LBA_t sector) { return sector / stripeSectors / 2 * stripeSectors + sector % stripeSectors; }
+        UINT landed(LBA_t first, UINT count, const UINT done[2]);
+
+    public:
+        StripedSource(BYTE pdrv0, BYTE pdrv1, UINT stripeSectors);
+        bool open(const char* name);
+        UINT read(void* dst, uint32_t ofs, UINT len);
+        unsigned char* fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz);
+        uint32_t capabilities() { return ASYNC; }
+};
+
+// A video written to the QSPI flash at flashOffset, read through XIP.
+class FlashSource : public FrameSource {
+    private:
+        uint32_t flashOffset;
+        int dmaChannel;
+
+    public:
+        FlashSource(uint32_t flashOffset);
+        bool open(const char* name);
+        UINT read(void* dst, uint32_t ofs, UINT len);
+        unsigned char* fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz);
+        uint32_t capabilities() { return ASYNC | SEEK_FREE | CONTIGUOUS; }
+};
+
+// A video already in memory, built into the firmware or made on the spot.
+class RamSource : public FrameSource {
+    private:
+        const unsigned char* video;
+        uint32_t length;
+
+    public:
+        RamSource(const unsigned char* video, uint32_t length);
+        bool open(const char* name) { return true; }
+        UINT read(void* dst, uint32_t ofs, UINT len);
+        unsigned char* fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz);
+        uint32_t capabilities() { return SEEK_FREE | CONTIGUOUS; }
+};
+
+#endif // FRAME_SOURCE_INCLUDED
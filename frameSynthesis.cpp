@@ -0,0 +1,436 @@
+#include "frameSynthesis.h"
+#include "videoFileReading.h"
+#include <string.h>
+
+#define SYNTH_STEPS 2048 // angles per frame, the encoder uses 2000 but a power of two keeps the angles exact
+#define SYNTH_NUM_LEDS 128
+#define SYNTH_HOLD_THRESHOLD 2 // holdThreshold in encoding.go
+#define SYNTH_MAX_HOLD_SLOTS 0xFFFF
+#define SINE_QUARTER 1024 // sine table entries per quarter turn
+
+// LEDs are interlaced, so LED i sits 64 - i - 1/4 spacings from the centre (negative past the centre)
+#define LED_DISTANCE(i) (1020 - 16 * (i))
+
+static const uint32_t groupBurstsPerSecond[4] = {39062, 19531, 19531, 39062}; // 7.5 Mbps, as in encoding.go
+
+typedef struct {
+    int16_t values[SINE_QUARTER + 1];
+} SineTable;
+
+// quarter of a sine wave in 2.14 fixed point, worked out by the compiler so the table sits in flash
+static constexpr SineTable makeSineTable() {
+    SineTable table = {};
+    for (int i = 0; SINE_QUARTER >= i; i++) {
+        double x = 1.5707963267948966 * i / SINE_QUARTER;
+        double term = x;
+        double sum = x;
+        for (int k = 1; 10 > k; k++) {
+            term *= -x * x / ((2 * k) * (2 * k + 1));
+            sum += term;
+        }
+        table.values[i] = (int16_t)(sum * 16384 + 0.5);
+    }
+    return table;
+}
+
+static constexpr SineTable sineTable = makeSineTable();
+
+// brightness curve the encoder applies to every value it writes (ledColorCorrection in storage.go)
+typedef struct {
+    unsigned char values[256];
+} CorrectionTable;
+
+static constexpr CorrectionTable makeCorrectionTable() {
+    const unsigned char points[16] = {0, 2, 4, 7, 11, 18, 31, 42, 50, 65, 80, 100, 125, 160, 200, 255};
+    CorrectionTable table = {};
+    for (int i = 0; 256 > i; i++) {
+        double position = i / 255.0 * 15;
+        int low = (int)position;
+        table.values[i] = 15 == low ? 255 : (unsigned char)(points[low] + (position - low) * (points[low + 1] - points[low]));
+    }
+    return table;
+}
+
+static constexpr CorrectionTable colorCorrection = makeCorrectionTable();
+
+// 5x7 font from ' ' to 'Z', a byte per column with the top row in bit 0
+static const unsigned char font5x7[][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, // space
+    {0x00, 0x00, 0x5F, 0x00, 0x00}, // !
+    {0x00, 0x07, 0x00, 0x07, 0x00}, // "
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, // #
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12}, // $
+    {0x23, 0x13, 0x08, 0x64, 0x62}, // %
+    {0x36, 0x49, 0x55, 0x22, 0x50}, // &
+    {0x00, 0x05, 0x03, 0x00, 0x00}, // '
+    {0x00, 0x1C, 0x22, 0x41, 0x00}, // (
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, // )
+    {0x08, 0x2A, 0x1C, 0x2A, 0x08}, // *
+    {0x08, 0x08, 0x3E, 0x08, 0x08}, // +
+    {0x00, 0x50, 0x30, 0x00, 0x00}, // ,
+    {0x08, 0x08, 0x08, 0x08, 0x08}, // -
+    {0x00, 0x60, 0x60, 0x00, 0x00}, // .
+    {0x20, 0x10, 0x08, 0x04, 0x02}, // /
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, // 0
+    {0x00, 0x42, 0x7F, 0x40, 0x00}, // 1
+    {0x42, 0x61, 0x51, 0x49, 0x46}, // 2
+    {0x21, 0x41, 0x45, 0x4B, 0x31}, // 3
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, // 4
+    {0x27, 0x45, 0x45, 0x45, 0x39}, // 5
+    {0x3C, 0x4A, 0x49, 0x49, 0x30}, // 6
+    {0x01, 0x71, 0x09, 0x05, 0x03}, // 7
+    {0x36, 0x49, 0x49, 0x49, 0x36}, // 8
+    {0x06, 0x49, 0x49, 0x29, 0x1E}, // 9
+    {0x00, 0x36, 0x36, 0x00, 0x00}, // :
+    {0x00, 0x56, 0x36, 0x00, 0x00}, // ;
+    {0x08, 0x14, 0x22, 0x41, 0x00}, // <
+    {0x14, 0x14, 0x14, 0x14, 0x14}, // =
+    {0x00, 0x41, 0x22, 0x14, 0x08}, // >
+    {0x02, 0x01, 0x51, 0x09, 0x06}, // ?
+    {0x32, 0x49, 0x79, 0x41, 0x3E}, // @
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, // A
+    {0x7F, 0x49, 0x49, 0x49, 0x36}, // B
+    {0x3E, 0x41, 0x41, 0x41, 0x22}, // C
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, // D
+    {0x7F, 0x49, 0x49, 0x49, 0x41}, // E
+    {0x7F, 0x09, 0x09, 0x09, 0x01}, // F
+    {0x3E, 0x41, 0x49, 0x49, 0x7A}, // G
+    {0x7F, 0x08, 0x08, 0x08, 0x7F}, // H
+    {0x00, 0x41, 0x7F, 0x41, 0x00}, // I
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, // J
+    {0x7F, 0x08, 0x14, 0x22, 0x41}, // K
+    {0x7F, 0x40, 0x40, 0x40, 0x40}, // L
+    {0x7F, 0x02, 0x0C, 0x02, 0x7F}, // M
+    {0x7F, 0x04, 0x08, 0x10, 0x7F}, // N
+    {0x3E, 0x41, 0x41, 0x41, 0x3E}, // O
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, // P
+    {0x3E, 0x41, 0x51, 0x21, 0x5E}, // Q
+    {0x7F, 0x09, 0x19, 0x29, 0x46}, // R
+    {0x46, 0x49, 0x49, 0x49, 0x31}, // S
+    {0x01, 0x01, 0x7F, 0x01, 0x01}, // T
+    {0x3F, 0x40, 0x40, 0x40, 0x3F}, // U
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, // V
+    {0x3F, 0x40, 0x38, 0x40, 0x3F}, // W
+    {0x63, 0x14, 0x08, 0x14, 0x63}, // X
+    {0x07, 0x08, 0x70, 0x08, 0x07}, // Y
+    {0x61, 0x51, 0x49, 0x45, 0x43}, // Z
+};
+
+typedef struct {
+    int32_t centerX, centerY, radius; // circle around the whole element, so the bar can pass it by quickly
+    uint32_t invScale; // 65536 / scale, saves a divide per LED
+    int32_t width, height; // in pixels
+} ElementBounds;
+
+// only core 0 synthesizes, and its stack is small
+static ElementBounds elementBounds[SCENE_MAX_ELEMENTS];
+static uint32_t shownColors[SYNTH_NUM_LEDS]; // what the LEDs have been told so far this frame
+
+static inline int32_t sine(uint16_t angle) {
+    uint32_t index = angle >> 4; // 4096 table steps a turn
+    uint32_t i = index & (SINE_QUARTER - 1);
+    switch (index >> 10) {
+        case 0:
+            return sineTable.values[i];
+        case 1:
+            return sineTable.values[SINE_QUARTER - i];
+        case 2:
+            return -sineTable.values[i];
+        default:
+            return -sineTable.values[SINE_QUARTER - i];
+    }
+}
+
+static inline int32_t cosine(uint16_t angle) {
+    return sine(angle + 0x4000);
+}
+
+// Bursts' worth of credit a group earns every step, in 16.16 fixed point.
+static uint32_t groupAllotment(int group) {
+    return (uint64_t)groupBurstsPerSecond[group] * SCENE_FRAME_TIME_US * 65536 / (1000000ull * SYNTH_STEPS);
+}
+
+static uint32_t groupMaxSlots(int group) {
+    return (((uint64_t)groupAllotment(group) * SYNTH_STEPS) >> 16) + 1;
+}
+
+uint32_t synthFrameLength() {
+    uint32_t length = 0;
+    for (int i = 0; 4 > i; i++) {
+        length += groupMaxSlots(i) * 8; // every slot is a burst at worst
+    }
+    return length;
+}
+
+static void prepareElements(const Scene* scene) {
+    for (int i = 0; scene->elementCount > i; i++) {
+        const SceneElement* e = &scene->elements[i];
+        ElementBounds* b = &elementBounds[i];
+        if (SCENE_ARC == e->kind) {
+            continue;
+        }
+
+        b->width = e->width;
+        b->height = e->height;
+        if (SCENE_TEXT == e->kind) {
+            b->width = 6 * strlen(e->text) - 1; // a column between letters
+            b->height = 7;
+        }
+        int32_t scale = e->scale > 0 ? e->scale : 16;
+        b->invScale = 65536 / scale;
+        b->centerX = e->x + b->width * scale / 2;
+        b->centerY = e->y - b->height * scale / 2;
+        b->radius = (b->width + b->height) * scale / 2 + 16; // never less than the half diagonal, plus an LED for rounding
+        if (b->width <= 0 || b->height <= 0) {
+            b->radius = -1; // nothing to draw
+        }
+    }
+}
+
+static bool elementPixel(const SceneElement* e, uint32_t col, uint32_t row) {
+    if (SCENE_SPRITE == e->kind) {
+        return (e->bitmap[row] >> col) & 1;
+    }
+
+    // text, five columns per letter and then a gap
+    uint32_t column = col % 6;
+    if (5 == column) {
+        return false;
+    }
+    unsigned char c = e->text[col / 6];
+    if (c >= 'a' && c <= 'z') {
+        c -= 'a' - 'A';
+    }
+    if (c < ' ' || c > 'Z') {
+        c = ' ';
+    }
+    return (font5x7[c - ' '][column] >> row) & 1;
+}
+
+// Resamples an image along the bar for LEDs from to to. The sample point moves the same amount from
+// one LED to the next, so after working out the first one it is only additions.
+static void drawImage(const SceneElement* e, const ElementBounds* b, int32_t c, int32_t s, int first, int from, int to,
+                      uint32_t* colors) {
+    // in 16.16 fixed point image pixels
+    int32_t distance = LED_DISTANCE(from);
+    int32_t u = (((int64_t)distance * c - ((int64_t)e->x << 14)) * b->invScale) >> 14;
+    int32_t v = ((((int64_t)e->y << 14) - (int64_t)distance * s) * b->invScale) >> 14;
+    int32_t du = -(((int64_t)16 * c * b->invScale) >> 14);
+    int32_t dv = ((int64_t)16 * s * b->invScale) >> 14;
+    uint32_t width = b->width;
+    uint32_t uLimit = (uint32_t)b->width << 16;
+    uint32_t vLimit = (uint32_t)b->height << 16;
+    for (int i = from; to >= i; i++, u += du, v += dv) {
+        if ((uint32_t)u >= uLimit || (uint32_t)v >= vLimit) {
+            continue; // off the picture, negative wraps round to large
+        }
+#if IMAGE_FILTERING
+        // the four pixel centres around the sample, weighted by how close it is in sixteenths
+        int32_t su = u > 0x8000 ? u - 0x8000 : 0;
+        int32_t sv = v > 0x8000 ? v - 0x8000 : 0;
+        uint32_t col = su >> 16;
+        uint32_t row = sv >> 16;
+        uint32_t wu = (su >> 12) & 15;
+        uint32_t wv = (sv >> 12) & 15;
+        const uint32_t* p = e->pixels + row * width + col;
+        uint32_t right = col + 1 < width ? 1 : 0;
+        uint32_t down = row + 1 < (uint32_t)b->height ? width : 0;
+        uint32_t w11 = wu * wv;
+        uint32_t w10 = (wu << 4) - w11;
+        uint32_t w01 = (wv << 4) - w11;
+        uint32_t w00 = 256 - w10 - w01 - w11;
+
+        // red and blue share a multiply, the weights add up to 256 so neither spills into the other
+        uint32_t rb = (p[0] & 0xFF00FF) * w00 + (p[right] & 0xFF00FF) * w10 + (p[down] & 0xFF00FF) * w01 +
+                      (p[down + right] & 0xFF00FF) * w11;
+        uint32_t g = (p[0] & 0xFF00) * w00 + (p[right] & 0xFF00) * w10 + (p[down] & 0xFF00) * w01 + (p[down + right] & 0xFF00) * w11;
+        colors[i - first] = ((rb >> 8) & 0xFF00FF) | ((g >> 8) & 0xFF00);
+#else
+        colors[i - first] = e->pixels[(v >> 16) * width + (u >> 16)];
+#endif
+    }
+}
+
+// Draws the scene along the bar at angle for LEDs first to first + count - 1.
+static void renderBar(const Scene* scene, uint16_t angle, int first, int count, uint32_t* colors) {
+    for (int i = 0; count > i; i++) {
+        colors[i] = scene->background;
+    }
+
+    int32_t c = cosine(angle);
+    int32_t s = sine(angle);
+    int last = first + count - 1;
+    for (int k = 0; scene->elementCount > k; k++) {
+        const SceneElement* e = &scene->elements[k];
+        if (SCENE_ARC == e->kind) {
+            // polar already, each half of the bar is a run of LEDs if it is within the arc's angles
+            for (int side = 0; 2 > side; side++) {
+                uint16_t sideAngle = angle + side * 0x8000; // LEDs past the centre point the other way
+                if (e->span && (uint16_t)(sideAngle - e->startAngle) >= e->span) {
+                    continue;
+                }
+                int32_t lo = side ? -e->outerRadius : e->innerRadius;
+                int32_t hi = side ? -e->innerRadius : e->outerRadius;
+                int from = (LED_DISTANCE(0) - hi + 15) >> 4;
+                int to = (LED_DISTANCE(0) - lo) >> 4;
+                if (from < first) {
+                    from = first;
+                }
+                if (to > last) {
+                    to = last;
+                }
+                for (int i = from; to >= i; i++) {
+                    colors[i - first] = e->color;
+                }
+            }
+            continue;
+        }
+
+        // where along the bar it passes the element, if it does at all
+        const ElementBounds* b = &elementBounds[k];
+        int32_t across = (b->centerY * c - b->centerX * s) >> 14;
+        if (across > b->radius || across < -b->radius) {
+            continue;
+        }
+        int32_t along = (b->centerX * c + b->centerY * s) >> 14;
+        int from = (LED_DISTANCE(0) - (along + b->radius) + 15) >> 4;
+        int to = (LED_DISTANCE(0) - (along - b->radius)) >> 4;
+        if (from < first) {
+            from = first;
+        }
+        if (to > last) {
+            to = last;
+        }
+        if (SCENE_IMAGE == e->kind) {
+            drawImage(e, b, c, s, first, from, to, colors);
+            continue;
+        }
+        for (int i = from; to >= i; i++) {
+            int32_t distance = LED_DISTANCE(i);
+            int32_t dx = ((distance * c) >> 14) - e->x;
+            int32_t dy = e->y - ((distance * s) >> 14);
+            if (dx < 0 || dy < 0) {
+                continue;
+            }
+            uint32_t col = ((uint32_t)dx * b->invScale) >> 16;
+            uint32_t row = ((uint32_t)dy * b->invScale) >> 16;
+            if (col < (uint32_t)b->width && row < (uint32_t)b->height && elementPixel(e, col, row)) {
+                colors[i - first] = e->color;
+            }
+        }
+    }
+}
+
+// Writes out holds for the slots skipped since the group's last burst.
+static void appendHolds(unsigned char* group, uint32_t* bursts, uint32_t* slots, uint32_t holdSlots) {
+    while (holdSlots > 0) {
+        uint32_t n = holdSlots > SYNTH_MAX_HOLD_SLOTS ? SYNTH_MAX_HOLD_SLOTS : holdSlots;
+        unsigned char* burst = group + *bursts * 8;
+        memset(burst, 0, 8);
+        burst[0] = HOLD_BURST;
+        burst[2] = n;
+        burst[3] = n >> 8;
+        *bursts += 1;
+        *slots += n;
+        holdSlots -= n;
+    }
+}
+
+void synthesizeFrame(const Scene* scene, bool leftBottom, unsigned char* out, unsigned char* groups[4],
+                     uint32_t bursts[4], uint32_t slots[4]) {
+    prepareElements(scene);
+    memset(shownColors, 0, sizeof(shownColors));
+
+    uint32_t allotments[4];
+    uint32_t credits[4] = {0, 0, 0, 0};
+    uint32_t holdSlots[4] = {0, 0, 0, 0};
+    for (int i = 0; 4 > i; i++) {
+        allotments[i] = groupAllotment(i);
+        groups[i] = out;
+        out += groupMaxSlots(i) * 8;
+        bursts[i] = 0;
+        slots[i] = 0;
+    }
+
+    uint16_t angle = leftBottom ? 0xC000 : 0x4000; // a half turn from straight down or straight up
+    uint32_t colors[SYNTH_NUM_LEDS / 4];
+    for (int step = 0; SYNTH_STEPS > step; step++) {
+        for (int groupIdx = 0; 4 > groupIdx; groupIdx++) {
+            credits[groupIdx] += allotments[groupIdx];
+            bool rendered = false;
+            while (credits[groupIdx] >= 0x10000) {
+                credits[groupIdx] -= 0x10000;
+                if (!rendered) {
+                    renderBar(scene, angle, groupIdx * 32, 32, colors); // the bar hasn't moved for more credits this step
+                    rendered = true;
+                }
+
+                // picking the most desperate channel of each chip, as EncodeFrame does
+                uint32_t* shown = shownColors + groupIdx * 32;
+                unsigned char packet[8];
+                int updatedLEDs[4];
+                int updatedShifts[4];
+                bool worthSending = false;
+                for (int chipIdx = 3; chipIdx >= 0; chipIdx--) {
+                    int mostLEDIdx = 0;
+                    int mostShift = 0;
+                    int maxDelta = -1;
+                    for (int ledIdx = chipIdx * 8; (chipIdx + 1) * 8 > ledIdx; ledIdx++) {
+                        uint32_t want = colors[ledIdx];
+                        uint32_t have = shown[ledIdx];
+                        if (want == have) {
+                            // flat colours mostly leave LEDs as they are, no need to look at the channels
+                            if (maxDelta < 0) {
+                                maxDelta = 0;
+                                mostLEDIdx = ledIdx;
+                                mostShift = 0;
+                            }
+                            continue;
+                        }
+                        for (int shift = 0; 24 > shift; shift += 8) {
+                            int delta = (int)((want >> shift) & 0xFF) - (int)((have >> shift) & 0xFF);
+                            if (delta < 0) {
+                                delta = -delta;
+                            }
+                            if (delta > maxDelta) {
+                                maxDelta = delta;
+                                mostLEDIdx = ledIdx;
+                                mostShift = shift;
+                            }
+                        }
+                    }
+
+                    int k = 3 - chipIdx;
+                    packet[2 * k] = (0x10 + 3 * (7 - mostLEDIdx % 8) + mostShift / 8) << 1;
+                    packet[2 * k + 1] = colorCorrection.values[(colors[mostLEDIdx] >> mostShift) & 0xFF];
+                    updatedLEDs[k] = mostLEDIdx;
+                    updatedShifts[k] = mostShift;
+                    if (maxDelta > SYNTH_HOLD_THRESHOLD) {
+                        worthSending = true;
+                    }
+                }
+
+                if (!worthSending) {
+                    // nothing has drifted enough to be seen, hold the LEDs as they are instead
+                    holdSlots[groupIdx]++;
+                    continue;
+                }
+
+                for (int k = 0; 4 > k; k++) {
+                    uint32_t mask = 0xFFu << updatedShifts[k];
+                    shown[updatedLEDs[k]] = (shown[updatedLEDs[k]] & ~mask) | (colors[updatedLEDs[k]] & mask);
+                }
+                appendHolds(groups[groupIdx], &bursts[groupIdx], &slots[groupIdx], holdSlots[groupIdx]);
+                holdSlots[groupIdx] = 0;
+                memcpy(groups[groupIdx] + bursts[groupIdx] * 8, packet, 8);
+                bursts[groupIdx]++;
+                slots[groupIdx]++;
+            }
+        }
+        angle += 0x8000 / SYNTH_STEPS;
+    }
+
+    for (int i = 0; 4 > i; i++) {
+        appendHolds(groups[i], &bursts[i], &slots[i], holdSlots[i]);
+    }
+}
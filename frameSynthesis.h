@@ -0,0 +1,48 @@
+#ifndef FRAME_SYNTHESIS_INCLUDED
+#define FRAME_SYNTHESIS_INCLUDED
+
+#include <stdint.h>
+
+#define SCENE_MAX_ELEMENTS 16
+
+// element kinds
+#define SCENE_ARC 0 // ring segment around the centre
+#define SCENE_SPRITE 1 // 1-bit bitmap
+#define SCENE_TEXT 2 // string in the built-in 5x7 font
+#define SCENE_IMAGE 3 // picture in ordinary rows and columns, resampled along the bar
+
+#define SCENE_RGB(r, g, b) ((uint32_t)(r) | ((uint32_t)(g) << 8) | ((uint32_t)(b) << 16))
+
+// Distances are in 1/16 of the spacing between LEDs from the centre of the display, so the outermost
+// LED is at 1020. x is to the right and y is up with the hall sensor side of the board at the bottom.
+// Angles are a full turn per 65536, counter clockwise from the right.
+typedef struct {
+    int kind;
+    uint32_t color; // SCENE_RGB
+    int32_t x, y; // top left corner of sprites, text and images
+    int32_t scale; // size of a sprite, text or image pixel
+    int32_t innerRadius, outerRadius; // arcs
+    uint16_t startAngle, span; // arcs, a span of 0 is the whole ring
+    const uint32_t* bitmap; // sprites, a row per uint32 from the top, bit 0 is the leftmost pixel
+    const uint32_t* pixels; // images, SCENE_RGB a pixel, rows from the top
+    int32_t width, height; // sprite or image size in pixels
+    const char* text; // text, letters are shown in upper case
+} SceneElement;
+
+// What a scene frame shows, elements are drawn in order over the background.
+typedef struct {
+    uint32_t background;
+    int elementCount;
+    SceneElement elements[SCENE_MAX_ELEMENTS];
+} Scene;
+
+// Bytes synthesizeFrame needs for a frame's bursts.
+uint32_t synthFrameLength();
+
+// Builds the bursts for a frame of the scene into out, the way EncodeFrame in the encoder does for a
+// video frame, and fills in where each group's bursts are, how many there are and the slots they cover.
+// leftBottom is as in EncodeFrame, it flips every frame.
+void synthesizeFrame(const Scene* scene, bool leftBottom, unsigned char* out, unsigned char* groups[4],
+                     uint32_t bursts[4], uint32_t slots[4]);
+
+#endif // FRAME_SYNTHESIS_INCLUDED
@@ -1,4 +1,5 @@
 #include "hardware.h"
+#include "playerConfig.h"
 
 #include "hw_config.h"
 #include "diskio.h"
@@ -20,25 +21,49 @@ static sd_card_t sd_card {
     .card_detected_true = 0,
 };
 
+#if STRIPED_PLAYBACK
+static spi_t spi2 = {
+    .hw_inst = spi0,
+    .miso_gpio = SD2_CARD_MISO_PIN,
+    .mosi_gpio = SD2_CARD_MOSI_PIN,
+    .sck_gpio = SD2_CARD_CLOCK_PIN,
+    .baud_rate = 25 * 1000 * 1000,
+};
+
+static sd_card_t sd_card2 {
+    .pcName = "1:",
+    .spi = &spi2,
+    .ss_gpio = SD2_CARD_CS_PIN,
+    .use_card_detect = false,
+    .card_detected_true = 0,
+};
+
+static sd_card_t* sd_cards[] = {&sd_card, &sd_card2};
+static spi_t* spis[] = {&spi, &spi2};
+#else
+static sd_card_t* sd_cards[] = {&sd_card};
+static spi_t* spis[] = {&spi};
+#endif
+
 size_t sd_get_num() {
-    return 1;
+    return sizeof(sd_cards) / sizeof(sd_cards[0]);
 }
 
 sd_card_t *sd_get_by_num(size_t num) {
-    if (num <= sd_get_num()) {
-        return &sd_card;
+    if (num < sd_get_num()) {
+        return sd_cards[num];
     } else {
         return NULL;
     }
 }
 
 size_t spi_get_num() {
-    return 1;
+    return sizeof(spis) / sizeof(spis[0]);
 }
 
 spi_t *spi_get_by_num(size_t num) {
-    if (num <= sd_get_num()) {
-        return &spi;
+    if (num < spi_get_num()) {
+        return spis[num];
     } else {
         return NULL;
     }
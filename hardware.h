@@ -1,5 +1,7 @@
 
 
+#include "playerConfig.h"
+
 #define GROUP1_DATA_PIN 2
 #define GROUP1_CLOCK_PIN 3
 #define GROUP1_CHIP_SELECT_PIN 4
@@ -8,9 +10,17 @@
 #define GROUP2_CLOCK_PIN 6
 #define GROUP2_CHIP_SELECT_PIN 7
 
+#if STRIPED_PLAYBACK
+// the second card needs spi0's clock pin (see below), so group 3 moves to spare pins. The LEDs are
+// driven by PIO, which can use any pins as long as chip select comes right after the clock
+#define GROUP3_DATA_PIN 26
+#define GROUP3_CLOCK_PIN 27
+#define GROUP3_CHIP_SELECT_PIN 28
+#else
 #define GROUP3_DATA_PIN 18
 #define GROUP3_CLOCK_PIN 19
 #define GROUP3_CHIP_SELECT_PIN 20
+#endif
 
 #define GROUP4_DATA_PIN 22
 #define GROUP4_CLOCK_PIN 23
@@ -18,8 +28,35 @@
 
 #define HALL_SENSOR_PIN 14
 #define LED_RESET_PIN 8
+#define BENCHMARK_PIN 13 // spare, jumper it to ground at power on to benchmark the card
 
 #define SD_CARD_CS_PIN 9
 #define SD_CARD_CLOCK_PIN 10
 #define SD_CARD_MOSI_PIN 11
-#define SD_CARD_MISO_PIN 12
\ No newline at end of file
+#define SD_CARD_MISO_PIN 12
+
+// second card for striped playback, on spi0. spi0's clock can only go on GPIO 2, 6, 18 or 22, which
+// are all LED group pins on this board, so it takes group 3's and group 3 moves to 26-28 (rewire the
+// board to match)
+#define SD2_CARD_CS_PIN 17
+#define SD2_CARD_CLOCK_PIN 18
+#define SD2_CARD_MOSI_PIN 19
+#define SD2_CARD_MISO_PIN 16
+
+// every pin above used once: a pin used twice adds its bit twice, so the sum and the or differ
+#define PIN_BIT(pin) (1ull << (pin))
+#define PINS_USED(op) (PIN_BIT(GROUP1_DATA_PIN) op PIN_BIT(GROUP1_CLOCK_PIN) op PIN_BIT(GROUP1_CHIP_SELECT_PIN) op \
+    PIN_BIT(GROUP2_DATA_PIN) op PIN_BIT(GROUP2_CLOCK_PIN) op PIN_BIT(GROUP2_CHIP_SELECT_PIN) op \
+    PIN_BIT(GROUP3_DATA_PIN) op PIN_BIT(GROUP3_CLOCK_PIN) op PIN_BIT(GROUP3_CHIP_SELECT_PIN) op \
+    PIN_BIT(GROUP4_DATA_PIN) op PIN_BIT(GROUP4_CLOCK_PIN) op PIN_BIT(GROUP4_CHIP_SELECT_PIN) op \
+    PIN_BIT(HALL_SENSOR_PIN) op PIN_BIT(LED_RESET_PIN) op PIN_BIT(BENCHMARK_PIN) op \
+    PIN_BIT(SD_CARD_CS_PIN) op PIN_BIT(SD_CARD_CLOCK_PIN) op PIN_BIT(SD_CARD_MOSI_PIN) op PIN_BIT(SD_CARD_MISO_PIN))
+#define SD2_PINS_USED(op) (PIN_BIT(SD2_CARD_CS_PIN) op PIN_BIT(SD2_CARD_CLOCK_PIN) op PIN_BIT(SD2_CARD_MOSI_PIN) op \
+    PIN_BIT(SD2_CARD_MISO_PIN))
+
+#if PINS_USED(+) != PINS_USED(|)
+#error "Two things share a pin in hardware.h"
+#endif
+#if STRIPED_PLAYBACK && (SD2_PINS_USED(+) != SD2_PINS_USED(|) || (SD2_PINS_USED(|) & PINS_USED(|)))
+#error "The second card's pins are taken by something else in hardware.h"
+#endif
\ No newline at end of file
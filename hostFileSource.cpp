@@ -0,0 +1,29 @@
+#include "hostFileSource.h"
+
+bool HostFileSource::open(const char* name) {
+    file = fopen(name, "rb");
+    return file != NULL;
+}
+
+void HostFileSource::close() {
+    if (file) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+UINT HostFileSource::read(void* dst, uint32_t ofs, UINT len) {
+    if (0 != fseek(file, ofs, SEEK_SET)) {
+        return 0;
+    }
+    return fread(dst, 1, len, file);
+}
+
+unsigned char* HostFileSource::fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz) {
+    // it all lands at once, so there's nothing to feed lz early
+    unsigned char* dst = buf + ofs % SECTOR_SIZE;
+    if (read(dst, ofs, len) != len) {
+        return NULL;
+    }
+    return dst;
+}
@@ -0,0 +1,22 @@
+#ifndef HOST_FILE_SOURCE_INCLUDED
+#define HOST_FILE_SOURCE_INCLUDED
+
+#include "frameSource.h"
+#include <stdio.h>
+
+// A file on the build machine, for host builds of the player's reading code (tools/cardImage).
+// Not part of the firmware.
+class HostFileSource : public FrameSource {
+    private:
+        FILE* file;
+
+    public:
+        HostFileSource() : file(NULL) {}
+        bool open(const char* name);
+        void close();
+        UINT read(void* dst, uint32_t ofs, UINT len);
+        unsigned char* fetch(unsigned char* buf, uint32_t ofs, UINT len, LzDecoder* lz);
+        uint32_t capabilities() { return 0; }
+};
+
+#endif // HOST_FILE_SOURCE_INCLUDED
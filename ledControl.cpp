@@ -15,6 +15,8 @@ uint32_t groupTimeBetweenPackets[4] = {0, 0, 0, 0};
 uint64_t groupNextPacketTime[4] = {0, 0, 0, 0};
 int groupPacketLength[4] = {0, 0, 0, 0};
 int numPacketsRetrieved[4] = {0, 0, 0, 0};
+int groupSlotPos[4] = {0, 0, 0, 0}; // slots played so far in the group's current frame, holds included
+int groupSlotLength[4] = {0, 0, 0, 0};
 
 unsigned char iRefs[16] = {
     20,
@@ -68,6 +70,13 @@ inline uint64_t abs(uint64_t a) {
 
 void updateGroupBuffers(uint32_t frameTime);
 
+#if STREAMING_PLAYBACK
+bool nextStreamChunk(int group, uint32_t frameTime);
+
+StreamChunk* currStreamChunks[4] = {nullptr, nullptr, nullptr, nullptr};
+volatile uint32_t streamUnderruns = 0; // times a group ran dry waiting for its next chunk
+#endif
+
 uint32_t frameTimeBuffer[15]; // circular buffer of frame times
 uint32_t frameTimeBufferPos = 0;
 
@@ -194,13 +203,15 @@ void displayOnLEDs() {
             // Dialating the frame time - if it hasn't finished the previous frame, it
             // will make the frame time shorter, and if it has, it will make the frame time longer
             // depending on the amount of error
-            if (currGroupPacketPos[0] > groupPacketLength[0] / 2) {
+            int framePos = groupSlotPos[0];
+            int frameLength = groupSlotLength[0];
+            if (framePos > frameLength / 2) {
                 // still working through the previous frame
-                float error = (groupPacketLength[0] - currGroupPacketPos[0] - 1) / (float)groupPacketLength[0];
+                float error = (frameLength - framePos - 1) / (float)frameLength;
                 frameTime = frameTime / (1 + error/2);
             } else {
                 // finished the previous frame - already started the next one
-                float error = currGroupPacketPos[0] / (float)groupPacketLength[0];
+                float error = framePos / (float)frameLength;
                 frameTime = frameTime * (1 + error);
             }
 
@@ -218,10 +229,17 @@ void displayOnLEDs() {
 
         for (int i = 0; 4 > i; i++) {
             // i is the group index
+#if STREAMING_PLAYBACK
+            if (currGroupPacketPos[i] >= groupPacketLength[i] && !nextStreamChunk(i, frameTime)) {
+                // next chunk isn't resident yet - try again next time around
+                continue;
+            }
+#else
             if (currGroupPacketPos[i] >= groupPacketLength[i]) {
                 // get new buffers
                 updateGroupBuffers(frameTime);
             }
+#endif
 
             // check if it is time to send the burst
             if (currTimeX32 >= groupNextPacketTime[i]) {
@@ -235,15 +253,24 @@ void displayOnLEDs() {
                 //     }
                 // }
 
-                // send the packet
-                groups[i]->sendData(buf);
+                if (buf[0] == HOLD_BURST) {
+                    // nothing changes for a while - skip ahead without touching the PIO
+                    uint32_t slots = buf[2] | (buf[3] << 8);
+                    groupSlotPos[i] += slots;
+                    groupNextPacketTime[i] = groupNextPacketTime[i] + (uint64_t)groupTimeBetweenPackets[i] * slots;
+                } else {
+                    // send the packet
+                    groups[i]->sendData(buf);
+                    groupSlotPos[i]++;
+                    groupNextPacketTime[i] = groupNextPacketTime[i] + groupTimeBetweenPackets[i];
+                }
                 currGroupPacketPos[i]++;
-                groupNextPacketTime[i] = groupNextPacketTime[i] + groupTimeBetweenPackets[i];
             }
         }
     }
 }
 
+#if !STREAMING_PLAYBACK
 void updateGroupBuffers(uint32_t frameTime) {
     GroupBufferInfo bufInfo = getGroupBuffers();
     currGroupBuffers[0] = bufInfo.group1Buf;
@@ -254,9 +281,44 @@ void updateGroupBuffers(uint32_t frameTime) {
     groupPacketLength[1] = bufInfo.group2BufLength;
     groupPacketLength[2] = bufInfo.group3BufLength;
     groupPacketLength[3] = bufInfo.group4BufLength;
+    groupSlotLength[0] = bufInfo.group1Slots;
+    groupSlotLength[1] = bufInfo.group2Slots;
+    groupSlotLength[2] = bufInfo.group3Slots;
+    groupSlotLength[3] = bufInfo.group4Slots;
 
     for (int j = 0; 4 > j; j++) {
         currGroupPacketPos[j] = 0;
-        groupTimeBetweenPackets[j] = timeBetweenPackets(frameTime, groupPacketLength[j]);
+        groupSlotPos[j] = 0;
+        groupTimeBetweenPackets[j] = timeBetweenPackets(frameTime, groupSlotLength[j]);
     }
-}
\ No newline at end of file
+}
+#else
+// Moves the group on to its next chunk. Returns false if the reader hasn't delivered it yet.
+bool nextStreamChunk(int group, uint32_t frameTime) {
+    bool wasPlaying = currStreamChunks[group] != nullptr;
+    if (wasPlaying) {
+        releaseStreamChunk(group);
+    }
+
+    StreamChunk* chunk = getStreamChunk(group);
+    currStreamChunks[group] = chunk;
+    currGroupPacketPos[group] = 0;
+    if (chunk == nullptr) {
+        groupPacketLength[group] = 0;
+        if (wasPlaying) {
+            streamUnderruns++;
+        }
+        return false;
+    }
+
+    currGroupBuffers[group] = chunk->data;
+    groupPacketLength[group] = chunk->bursts;
+    if (chunk->frameStart) {
+        // new frame for this group - spread its slots over the frame time
+        groupSlotPos[group] = 0;
+        groupSlotLength[group] = chunk->frameSlots;
+        groupTimeBetweenPackets[group] = timeBetweenPackets(frameTime, chunk->frameSlots);
+    }
+    return true;
+}
+#endif
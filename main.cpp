@@ -1,8 +1,10 @@
 #include <stdio.h>
+#include <string.h>
 #include "pico/stdlib.h"
 
 #include "LEDController.hpp"
 #include "videoFileReading.h"
+#include "cardBenchmark.h"
 #include "hardware.h"
 #include "hw_config.h" // SD card
 #include "f_util.h"
@@ -11,20 +13,132 @@
 
 void displayOnLEDs();
 
+#if SCENE_PLAYBACK
+Scene clockScene;
+char clockText[6];
+
+// time since power on: minutes and seconds in the middle, a ring, and a hand going round once a minute
+void updateClock(Scene* scene, uint32_t frame) {
+    uint32_t seconds = time_us_64() / 1000000;
+    snprintf(clockText, sizeof(clockText), "%02u:%02u", (seconds / 60) % 100, seconds % 60);
+    scene->elements[2].startAngle = 0x4000 - (seconds % 60) * 65536 / 60 - 0x200; // clockwise from the top
+}
+
+void setupClockScene() {
+    clockScene.background = SCENE_RGB(0, 0, 0);
+    clockScene.elementCount = 3;
+
+    SceneElement* ring = &clockScene.elements[0];
+    ring->kind = SCENE_ARC;
+    ring->color = SCENE_RGB(0, 0, 80);
+    ring->innerRadius = 60 * 16;
+    ring->outerRadius = 64 * 16;
+
+    SceneElement* text = &clockScene.elements[1];
+    text->kind = SCENE_TEXT;
+    text->color = SCENE_RGB(255, 255, 255);
+    text->text = clockText;
+    text->scale = 2 * 16;
+    text->x = -29 * 16; // 29 pixels wide, 7 high
+    text->y = 7 * 16;
+
+    SceneElement* hand = &clockScene.elements[2];
+    hand->kind = SCENE_ARC;
+    hand->color = SCENE_RGB(255, 40, 0);
+    hand->innerRadius = 40 * 16;
+    hand->outerRadius = 58 * 16;
+    hand->span = 0x400;
+}
+#endif
+
+#if !FLASH_PLAYBACK && !SCENE_PLAYBACK && !STRIPED_PLAYBACK
+int readCardBlocks(void* card, uint8_t* buffer, uint64_t sector, uint32_t count) {
+    sd_card_t* pSD = (sd_card_t*)card;
+    return pSD->read_blocks(pSD, buffer, sector, count);
+}
+
+// How the SPI's polled and DMA transfers compare, to check SPI_POLL_MAX by.
+void reportSpiCrossover(void* card) {
+    sd_card_t* pSD = (sd_card_t*)card;
+    uint32_t polledNs[SPI_POLL_MEASURE_MAX];
+    uint32_t dmaNs[SPI_POLL_MEASURE_MAX];
+    spi_lock(pSD->spi); // the card is deselected between reads, so it ignores the fill bytes
+    size_t crossover = spi_measure_poll_crossover(pSD->spi, SPI_POLL_MEASURE_MAX, polledNs, dmaNs);
+    spi_unlock(pSD->spi);
+    benchmarkReport("SPI transfers: polling is as fast as DMA up to %u bytes, transfers up to %u are polled\n",
+                    crossover, pSD->spi->poll_max);
+    for (int length = 1; SPI_POLL_MEASURE_MAX >= length; length *= 2) {
+        benchmarkReport("  %2d bytes: polled %6u ns, DMA %6u ns\n", length, polledNs[length - 1], dmaNs[length - 1]);
+    }
+}
+
+// Benchmark mode, if BENCHMARK_PIN is held low or there's a marker file. Playback carries on after,
+// so take the marker file off the card once the results are in.
+void benchmarkIfAsked(sd_card_t* pSD, uint32_t mountUs) {
+    gpio_init(BENCHMARK_PIN);
+    gpio_set_dir(BENCHMARK_PIN, GPIO_IN);
+    gpio_pull_up(BENCHMARK_PIN);
+    sleep_us(10); // for the pull up to win
+    bool pinHeld = !gpio_get(BENCHMARK_PIN);
+    gpio_disable_pulls(BENCHMARK_PIN);
+
+    char videoName[PLAYLIST_NAME_LENGTH] = "video.crv";
+    FIL marker;
+    bool markerFound = FR_OK == f_open(&marker, BENCHMARK_MARKER_FILE, FA_READ);
+    if (markerFound) {
+        char line[PLAYLIST_NAME_LENGTH];
+        if (f_gets(line, sizeof(line), &marker)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0]) {
+                strcpy(videoName, line);
+            }
+        }
+        f_close(&marker);
+    }
+    if (!pinHeld && !markerFound) {
+        return;
+    }
+
+    printf("Benchmarking the card: SPI at %u Hz%s\n", pSD->baud_rate, pSD->high_speed ? ", high speed" : "");
+    BenchmarkCard card = {pSD, &pSD->fatfs, pSD->pcName, mountUs, readCardBlocks, pSD->sectors, pSD->au_sectors,
+                          time_us_64, reportSpiCrossover};
+    uint32_t bufferSize;
+    unsigned char* buffer = borrowFrameMemory(&bufferSize);
+    runCardBenchmark(&card, videoName, buffer, bufferSize);
+}
+#endif
+
 int main() {
 
     // Initialize chosen serial port
     stdio_init_all();
+#if !FLASH_PLAYBACK && !SCENE_PLAYBACK && !STRIPED_PLAYBACK
     sd_card_t* pSD = sd_get_by_num(0);
+    uint32_t mountStart = time_us_32();
     FRESULT res = f_mount(&pSD->fatfs, pSD->pcName, 1);
     if (res != FR_OK) {
         panic("Error mounting SD card: %d\n", res);
     }
+    benchmarkIfAsked(pSD, time_us_32() - mountStart); // before core 1 starts, so the card has the bus to itself
+#endif
 
     printf("Starting...\n");
 
     // start the displayOnLEDs function on core 1
     multicore_launch_core1(displayOnLEDs);
 
+#if SCENE_PLAYBACK
+    setupClockScene();
+    runSceneReader(&clockScene, updateClock);
+#elif FLASH_PLAYBACK
+    runFlashReader();
+#elif STRIPED_PLAYBACK
+    runStripedReader(); // raw cards, so nothing to mount
+#else
+    runPlaylist("playlist.txt"); // only comes back if there isn't one
+#if !STREAMING_PLAYBACK
+    runImageFileReader("video.cri"); // same
+#endif
     runFileReader("video.crv");
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+#ifndef PLAYER_CONFIG_INCLUDED
+#define PLAYER_CONFIG_INCLUDED
+
+// Streaming playback: instead of loading whole frames, the reader fetches each group's
+// bursts in small chunks, in the order core 1 will need them, into a ring per group.
+// Core 1 starts on a chunk as soon as it is resident. Uses a few KB instead of two full frames.
+#ifndef STREAMING_PLAYBACK
+#define STREAMING_PLAYBACK 0
+#endif
+
+// Whole-frame playback: frame buffers are carved out of this arena when the file is opened,
+// sized from the largest frame in the file. Smaller videos get more frames queued ahead.
+#define FRAME_ARENA_SIZE (2 * (73728 + 2 * 512))
+#define FRAME_POOL_MAX_SLOTS 32
+
+// Frames kept in the arena after the first pass so the wrap back to the start of the video
+// doesn't have to wait on the card. Fewer get pinned if the arena is short of room.
+#define LOOP_CACHE_FRAMES 4
+
+// RAM loop: when every frame of the video fits in the arena at once, they are read once and
+// then played from RAM forever, with no more card traffic (whole-frame playback only).
+#ifndef RAM_LOOP_PLAYBACK
+#define RAM_LOOP_PLAYBACK 1
+#endif
+
+// Flash playback: plays a .crv image written to the on-board QSPI flash at FLASH_VIDEO_OFFSET
+// instead of video.crv on the SD card (see SaveFlashImage in the encoder). Frames are streamed
+// out of flash by DMA, so there's no card to fly out and far more bandwidth to spend on bursts.
+#ifndef FLASH_PLAYBACK
+#define FLASH_PLAYBACK 0
+#endif
+#define FLASH_VIDEO_OFFSET (1024 * 1024) // from the start of flash, the firmware has to end before it
+
+#if FLASH_PLAYBACK && STREAMING_PLAYBACK
+#error "Flash playback needs whole-frame playback"
+#endif
+
+// Read deadlines: each frame read gets until core 1 will want the frame, going by how often it
+// has been taking them (but never less than READ_MIN_BUDGET_US). A card that stalls, or keeps
+// failing CRCs past that, costs the frame instead of holding core 0 up for seconds.
+#ifndef READ_DEADLINES
+#define READ_DEADLINES 1
+#endif
+#define READ_MIN_BUDGET_US 8000
+
+// Striped playback: the video is spread over the raw sectors of two cards on separate SPIs,
+// STRIPE_SECTORS at a time turn about (see SaveStripedImages in the encoder), and frames are read
+// from both cards at once. The second card's pins are the SD2_ ones in hardware.h, and LED group 3
+// moves to make room for them.
+#ifndef STRIPED_PLAYBACK
+#define STRIPED_PLAYBACK 0
+#endif
+#define STRIPE_SECTORS 8
+
+#if STRIPED_PLAYBACK && FLASH_PLAYBACK
+#error "Striped playback and flash playback are two different places to get the video from"
+#endif
+
+// Scene playback: frames are built on core 0 from a scene of arcs, sprites and text (see
+// frameSynthesis.h) instead of being read, so live content like clocks needs no card at all.
+// The burst budget is worked out for frames of SCENE_FRAME_TIME_US, as the encoder does with the
+// video's frame time.
+#ifndef SCENE_PLAYBACK
+#define SCENE_PLAYBACK 0
+#endif
+#define SCENE_FRAME_TIME_US 41666
+
+// Image streams: small pictures (.cri, see docs/fileFormat.md) resampled onto the bar on core 0 as a
+// scene, so low resolution content takes a fraction of the storage and card bandwidth of bursts.
+// Filtering blends the four nearest pixels with integer weights, smoother but several times the
+// work per LED, so it may not keep up with a full-size image at the stock clock.
+#define IMAGE_MAX_PIXELS (96 * 96)
+#ifndef IMAGE_FILTERING
+#define IMAGE_FILTERING 0
+#endif
+
+#if SCENE_PLAYBACK && (STREAMING_PLAYBACK || FLASH_PLAYBACK || STRIPED_PLAYBACK)
+#error "Scene playback needs whole-frame playback and no flash or striped video"
+#endif
+
+// Card benchmark: holding BENCHMARK_PIN low at power on, or putting BENCHMARK_MARKER_FILE on the card
+// (its first line naming the video to check the card against, video.crv if it's empty), times the
+// card's reads before anything plays and writes what it found to BENCHMARK_RESULTS_FILE (only to the
+// serial port when FatFs is built read-only, as FatFs_SPI_player is).
+#define BENCHMARK_MARKER_FILE "bench.txt" // 8.3, the player's FatFs has no long names
+#define BENCHMARK_RESULTS_FILE "benchres.txt"
+#define BENCHMARK_FRAME_TIME_US 41666 // what core 1 starts out assuming, 12 turns a second
+#define BENCHMARK_SEQUENTIAL_BYTES (8 * 1024 * 1024)
+#define BENCHMARK_RUN_SECTORS 32 // sectors per sequential read, the chunk rings only hold a little more
+#define BENCHMARK_STRIDED_READS 256 // spread evenly over the whole card
+#define BENCHMARK_STRIDED_SECTORS 8
+#define BENCHMARK_FRAMES 500 // frames read like the player does, from the start of the video
+#define BENCHMARK_MOUNTS 8 // remounts, the card is already going so these are FatFs and the sector cache
+#define BENCHMARK_SMALL_READS 1000 // f_reads of data already in the file's buffer, what FatFs costs per call
+
+// Playlist: playlist.txt on the card lists the files to play in turn (see runPlaylist)
+#define PLAYLIST_MAX_ENTRIES 16
+#define PLAYLIST_NAME_LENGTH 32
+
+#define STREAM_CHUNK_BURSTS 64 // 512 bytes of bursts per chunk
+#define STREAM_RING_CHUNKS 8   // chunks in flight per group
+
+#endif // PLAYER_CONFIG_INCLUDED
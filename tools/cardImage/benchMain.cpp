@@ -0,0 +1,77 @@
+// Runs the player's card benchmark (cardBenchmark.cpp) on a card image through the card emulator, so a
+// card's numbers can be tried out before one is in hand, and benchmark changes tested without one.
+// The results are printed and written into the image, as the player writes them onto the card (cardBenchPlayer,
+// built read-only like the player's FatFs, only prints them).
+//
+//   cardBench [-au KB] [-clock MHz] [-access us] [-gap us] [-auchange us] [-stall blocks:us] card.img [video.crv]
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ff.h"
+#include "cardImage.h"
+#include "cardBenchmark.h"
+#include "playerConfig.h"
+
+#define SECTOR_SIZE 512
+
+static void usage() {
+    fprintf(stderr, "usage: cardBench [-au KB] [-clock MHz] [-access us] [-gap us] [-auchange us] [-stall blocks:us] "
+                    "card.img [video.crv]\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    DWORD au = 4096 * 1024 / SECTOR_SIZE;
+    EmulatedTiming timing = {25 * 1000 * 1000, 300, 20, 1000, 0, 0}; // a middling card at the player's clock
+    int arg = 1;
+    for (; argc > arg + 1 && '-' == argv[arg][0]; arg += 2) {
+        const char* value = argv[arg + 1];
+        if (0 == strcmp(argv[arg], "-au")) {
+            au = strtoul(value, NULL, 10) * 1024 / SECTOR_SIZE;
+        } else if (0 == strcmp(argv[arg], "-clock")) {
+            timing.clockHz = strtoul(value, NULL, 10) * 1000 * 1000;
+        } else if (0 == strcmp(argv[arg], "-access")) {
+            timing.accessUs = strtoul(value, NULL, 10);
+        } else if (0 == strcmp(argv[arg], "-gap")) {
+            timing.blockGapUs = strtoul(value, NULL, 10);
+        } else if (0 == strcmp(argv[arg], "-auchange")) {
+            timing.auChangeUs = strtoul(value, NULL, 10);
+        } else if (0 == strcmp(argv[arg], "-stall") && 2 == sscanf(value, "%u:%u", &timing.stallEvery, &timing.stallUs)) {
+        } else {
+            usage();
+        }
+    }
+    if (argc - arg < 1 || argc - arg > 2 || 0 == au || 0 == timing.clockHz) {
+        usage();
+    }
+    const char* imagePath = argv[arg];
+    const char* videoName = argc - arg > 1 ? argv[arg + 1] : "video.crv";
+
+    FILE* image = fopen(imagePath, "rb+");
+    if (!image) {
+        perror(imagePath);
+        return 1;
+    }
+    fseeko(image, 0, SEEK_END);
+    LBA_t sectors = ftello(image) / SECTOR_SIZE;
+    emulatedCardAttach(image, sectors, au, &timing);
+
+    static FATFS fs;
+    FRESULT res = f_mount(&fs, "", 1);
+    uint32_t mountUs = emulatedCardNow();
+    if (FR_OK != res) {
+        fprintf(stderr, "Mounting %s failed (FatFs error %d)\n", imagePath, res);
+        return 1;
+    }
+
+    // the same room as the player's frame arena
+    static uint8_t buffer[FRAME_ARENA_SIZE];
+    BenchmarkCard card = {NULL, &fs, "", mountUs, emulatedCardRead, sectors, au, emulatedCardNow, NULL};
+    bool fastEnough = runCardBenchmark(&card, videoName, buffer, sizeof(buffer));
+
+    f_mount(NULL, "", 0);
+    fclose(image);
+    return fastEnough ? 0 : 1;
+}
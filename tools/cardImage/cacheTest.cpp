@@ -0,0 +1,177 @@
+// Checks the sector cache in the FatFs glue (FatFs_SPI's glue.c) on the player's SD driver and an
+// emulated card: sequential single sector reads coming in DISK_CACHE_AHEAD at a time, FAT sectors kept
+// in their own slots without breaking up a sequential reader, the hit and miss counts, and writes
+// keeping the cache in step or dropping it when they fail.
+//
+//   cacheTest scratch-dir
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "cardImage.h"
+#include "check.h"
+#include "diskio.h"
+#include "diskio_cache.h"
+#include "hw_config.h"
+#include "sd_card.h"
+
+#define CARD_SECTORS 2048
+#define AU_SECTORS 8192
+#define CS_PIN 13
+#define FAT_BASE 64 // where the test's FAT is, two copies of FAT_SECTORS
+#define FAT_SECTORS 16
+
+static spi_t spi;
+static sd_card_t card;
+
+extern "C" {
+size_t sd_get_num() { return 1; }
+sd_card_t* sd_get_by_num(size_t num) { return 0 == num ? &card : NULL; }
+size_t spi_get_num() { return 1; }
+spi_t* spi_get_by_num(size_t num) { return 0 == num ? &spi : NULL; }
+}
+
+// what goes to the card under the cache
+struct Transfer {
+    uint64_t sector;
+    uint32_t count;
+};
+static std::vector<Transfer> reads;
+static int (*driverRead)(sd_card_t*, uint8_t*, uint64_t, uint32_t);
+static int writeResult; // the card doesn't take writes, so they only go as far as here
+
+static int countedRead(sd_card_t* sd, uint8_t* buffer, uint64_t sector, uint32_t count) {
+    reads.push_back({sector, count});
+    return driverRead(sd, buffer, sector, count);
+}
+
+static int fakeWrite(sd_card_t* sd, const uint8_t* buffer, uint64_t sector, uint32_t count) {
+    return writeResult;
+}
+
+static unsigned char expected(uint32_t ofs) {
+    return (unsigned char)(ofs * 7 + ofs / 251);
+}
+
+static bool holds(const BYTE* buffer, LBA_t sector) {
+    for (uint32_t i = 0; 512 > i; i++) {
+        if (buffer[i] != expected(sector * 512 + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads a sector through the glue and says whether it came from the card (with count sectors at
+// once) or the cache (count 0), and had the card's bytes in it.
+static bool readSector(LBA_t sector, uint32_t count) {
+    static BYTE buffer[512];
+    size_t before = reads.size();
+    uint32_t hits = disk_cache_hits, misses = disk_cache_misses;
+    if (RES_OK != disk_read(0, buffer, sector, 1) || !holds(buffer, sector)) {
+        return false;
+    }
+    if (0 == count) {
+        return before == reads.size() && hits + 1 == disk_cache_hits && misses == disk_cache_misses;
+    }
+    return before + 1 == reads.size() && sector == reads.back().sector && count == reads.back().count &&
+           hits == disk_cache_hits && misses + 1 == disk_cache_misses;
+}
+
+static void testSequential() {
+    CHECK(readSector(200, 1)); // nothing to go on yet
+    CHECK(readSector(201, DISK_CACHE_AHEAD)); // the one after, so the next few come too
+    for (LBA_t sector = 202; 201 + DISK_CACHE_AHEAD > sector; sector++) {
+        CHECK(readSector(sector, 0));
+    }
+    CHECK(readSector(201 + DISK_CACHE_AHEAD, DISK_CACHE_AHEAD));
+    CHECK(readSector(100, 1)); // a jump isn't sequential
+    CHECK(readSector(201 + DISK_CACHE_AHEAD, 1)); // and a jump back neither, though it has been read before
+}
+
+static void testFat() {
+    LBA_t next = 300;
+    CHECK(readSector(next - 1, 1));
+    CHECK(readSector(next, DISK_CACHE_AHEAD));
+    CHECK(readSector(FAT_BASE + 3, 1)); // following the cluster chain
+    CHECK(readSector(next + 1, 0)); // the read-ahead is still there
+    CHECK(readSector(FAT_BASE + 3, 0));
+    CHECK(readSector(next + 2, 0));
+    CHECK(readSector(next + DISK_CACHE_AHEAD - 1, 0));
+    CHECK(readSector(FAT_BASE + FAT_SECTORS + 5, 1)); // the second FAT copy is FAT too
+    CHECK(readSector(next + DISK_CACHE_AHEAD, DISK_CACHE_AHEAD)); // and the reader is still sequential
+
+    // the least recently used FAT sector goes first
+    CHECK(readSector(FAT_BASE + 3, 0));
+    CHECK(readSector(FAT_BASE + 4, 1));
+    CHECK(readSector(FAT_BASE + 3, 0));
+    CHECK(readSector(FAT_BASE + 4, 0));
+    CHECK(readSector(FAT_BASE + FAT_SECTORS + 5, 1));
+}
+
+static void testWrites() {
+    static BYTE written[512], buffer[512];
+    memset(written, 0x5a, sizeof(written));
+    LBA_t next = 400;
+    CHECK(readSector(next - 1, 1));
+    CHECK(readSector(next, DISK_CACHE_AHEAD));
+    CHECK(readSector(FAT_BASE + 6, 1));
+
+    // a write that went through shows in the cached copies (the card itself doesn't take it)
+    writeResult = SD_BLOCK_DEVICE_ERROR_NONE;
+    CHECK(RES_OK == disk_write(0, written, next + 1, 1));
+    CHECK(RES_OK == disk_write(0, written, FAT_BASE + 6, 1));
+    uint32_t misses = disk_cache_misses;
+    CHECK(RES_OK == disk_read(0, buffer, next + 1, 1) && 0 == memcmp(buffer, written, 512));
+    CHECK(RES_OK == disk_read(0, buffer, FAT_BASE + 6, 1) && 0 == memcmp(buffer, written, 512));
+    CHECK(misses == disk_cache_misses);
+    CHECK(readSector(next + 2, 0));
+
+    // one that failed leaves no telling what's on the card, so it all comes from the card again
+    writeResult = SD_BLOCK_DEVICE_ERROR_WRITE;
+    CHECK(RES_OK != disk_write(0, written, next + 3, 1));
+    CHECK(readSector(next + 1, 1));
+    CHECK(readSector(FAT_BASE + 6, 1));
+}
+
+int main(int argc, char** argv) {
+    std::string dir = argc > 1 ? argv[1] : ".";
+    std::string path = dir + "/cache.img";
+    FILE* image = fopen(path.c_str(), "w+b");
+    if (!image) {
+        fprintf(stderr, "cacheTest: can't write %s\n", path.c_str());
+        return 1;
+    }
+    for (uint32_t i = 0; CARD_SECTORS * 512 > i; i++) {
+        fputc(expected(i), image);
+    }
+    fflush(image);
+
+    EmulatedTiming timing = {25 * 1000 * 1000, 300, 20, 1000, 0, 0, true, 0};
+    emulatedCardAttachDrive(0, image, CARD_SECTORS, AU_SECTORS, &timing);
+    emulatedSpiWire(0, spi1, CS_PIN);
+    spi.hw_inst = spi1;
+    spi.baud_rate = 25 * 1000 * 1000;
+    card.pcName = "0:";
+    card.spi = &spi;
+    card.ss_gpio = CS_PIN;
+    card.m_Status = STA_NOINIT;
+    CHECK(0 == (disk_initialize(0) & STA_NOINIT));
+
+    // as if a FAT32 volume were mounted, for the glue to tell FAT sectors by
+    card.fatfs.fs_type = FS_FAT32;
+    card.fatfs.fatbase = FAT_BASE;
+    card.fatfs.fsize = FAT_SECTORS;
+    card.fatfs.n_fats = 2;
+    driverRead = card.read_blocks;
+    card.read_blocks = countedRead;
+    card.write_blocks = fakeWrite;
+
+    testSequential();
+    testFat();
+    testWrites();
+    fclose(image);
+    return checkResult("cacheTest");
+}
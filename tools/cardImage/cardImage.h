@@ -0,0 +1,87 @@
+#ifndef CARD_IMAGE_INCLUDED
+#define CARD_IMAGE_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Points the FatFs disk functions at the image. au is the allocation unit in sectors, a power of 2.
+void imageAttach(FILE* file, LBA_t sectors, DWORD au);
+
+// Lays a .crv out again with every frame starting on a sector boundary and the sector aligned and
+// contiguous flags set. Returns a malloc'd copy and its length in *alignedLength, or NULL with a
+// reason in *why if the file can't carry the flags (not a .crv, or a header with no flags field).
+unsigned char* alignVideo(const unsigned char* data, size_t length, size_t* alignedLength, const char** why);
+
+// cardBench's SD card emulator: the image read through a model of a card on SPI, with every read moving
+// a clock on by how long the card would have taken instead of taking that long.
+typedef struct {
+    uint32_t clockHz; // SPI clock
+    uint32_t accessUs; // from a read command to the first block's start token
+    uint32_t blockGapUs; // between the blocks of a multiple block read
+    uint32_t auChangeUs; // more when a read goes into a different allocation unit from the last one
+    uint32_t stallEvery; // the card goes away for stallUs once in this many blocks, on average (0 never)
+    uint32_t stallUs;
+
+    // for the SD driver on the SPI side (emulatedCardExchange), clockHz being whatever the driver sets
+    bool highSpeed; // CMD6 can switch the card to high speed (SCK up to 50MHz)
+    uint32_t maxClockHz; // blocks read at a faster SCK come back corrupt, 0 for the most its speed mode allows
+} EmulatedTiming;
+
+#define EMULATED_CARDS 2 // drives 0 and 1, for striped playback
+
+// Points the FatFs disk functions (emulatedDisk.c) at the emulated card, as imageAttach does for the
+// plain image. emulatedCardAttachDrive attaches a card as another drive.
+void emulatedCardAttach(FILE* file, LBA_t sectors, DWORD au, const EmulatedTiming* timing);
+void emulatedCardAttachDrive(BYTE pdrv, FILE* file, LBA_t sectors, DWORD au, const EmulatedTiming* timing);
+
+// The drive's image, or NULL if nothing is attached.
+FILE* emulatedCardImage(BYTE pdrv, LBA_t* sectors, DWORD* au);
+
+// Block reads for the benchmark on drive 0, 0 on success like the player's SD driver.
+int emulatedCardRead(void* card, uint8_t* buffer, uint64_t sector, uint32_t count);
+
+// Starts reading count sectors on the drive, landing in buffer in runs as disk_read_async_strided
+// describes (0 for firstRun and run is one run). The card reads on its own time from now on, running
+// out of budgetUs (0 for none). Returns 0, or -1 if the read can't be started.
+int emulatedCardStart(BYTE pdrv, uint8_t* buffer, uint64_t sector, uint32_t count, uint32_t firstRun, uint32_t run,
+                      uint32_t gap, uint32_t budgetUs);
+
+// Hands over the sectors that have landed by now, moving the clock on to the next one if none have.
+// Returns 1 once the read is over with *result 0 if it went fine, 1 if it ran out of budget, -1 if it
+// failed. While it returns 0, *done (may be NULL) is how many sectors have landed.
+int emulatedCardPoll(BYTE pdrv, int* result, uint32_t* done);
+
+// The card's SPI side, for running the player's SD driver on it (emulatedSpi.c): chip select, and one
+// byte each way at SCK clockHz, which moves the clock on by a byte's time. The card answers the
+// commands the driver uses for bring-up and reads (CMD0, 6, 8, 9, 12, 13, 16, 17, 18, 55, 58, 59,
+// ACMD13 and 41), and goes on timing and clock limits from its EmulatedTiming. Writes aren't modelled.
+void emulatedCardSelect(BYTE pdrv, bool selected);
+uint8_t emulatedCardExchange(BYTE pdrv, uint8_t mosi, uint32_t clockHz);
+
+// Whether CMD6 has switched the card to high speed.
+bool emulatedCardHighSpeed(BYTE pdrv);
+
+// Puts the card on an emulated SPI (emulatedSpi.c) with its chip select on csPin.
+struct spi_inst;
+void emulatedSpiWire(BYTE pdrv, struct spi_inst* spi, unsigned csPin);
+
+// The emulated clock in microseconds, and moving it on for time spent elsewhere.
+uint64_t emulatedCardNow();
+void emulatedCardWait(uint32_t us);
+
+// The most cards that have had a read going at once.
+int emulatedCardsMostBusy();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_IMAGE_INCLUDED
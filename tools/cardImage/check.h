@@ -0,0 +1,28 @@
+#ifndef CHECK_INCLUDED
+#define CHECK_INCLUDED
+
+#include <stdio.h>
+
+// What the host checks and benchmarks use to check things: CHECK notes a failed condition and carries
+// on, and main ends with return checkResult("name").
+static int failures = 0;
+
+#define CHECK(condition)                                              \
+    do {                                                              \
+        if (!(condition)) {                                           \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+// Says how the checks went, and returns the exit code for it.
+static int checkResult(const char* name) {
+    if (failures) {
+        fprintf(stderr, "%s: %d checks failed\n", name, failures);
+        return 1;
+    }
+    printf("%s: all passed\n", name);
+    return 0;
+}
+
+#endif // CHECK_INCLUDED
@@ -0,0 +1,123 @@
+// Checks the SD driver's CRCs (FatFs_SPI's crc.c) against plain bit at a time ones, and the way a block's
+// CRC is split between the CPU and the DMA sniffer: the driver works out the CRC of the bytes that came in
+// with the start token and seeds the sniffer with it, which carries on over the rest. Then times the
+// slice-by-4 crc16() against the byte at a time table loop it replaced, over 512 byte blocks. The build
+// machine is a lot quicker than the RP2040, so the times are for comparing the two with each other.
+//
+//   crcBench [blocks]
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "check.h"
+
+extern "C" {
+#include "crc.h" // no extern "C" of its own
+}
+
+#define DEFAULT_BLOCKS 200000
+#define BLOCK_SIZE 512
+#define MAX_LENGTH 600
+
+static uint16_t byteTable[256];
+
+// CRC-16/XMODEM carried on from seed a bit at a time, as the sniffer computes it
+static uint16_t sniffer(uint16_t seed, const unsigned char* data, size_t length) {
+    uint16_t crc = seed;
+    for (size_t i = 0; length > i; i++) {
+        crc ^= data[i] << 8;
+        for (int bit = 0; 8 > bit; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// the one table, one byte a step loop crc.c had before slice-by-4
+static uint16_t bytewise(uint16_t crc, const unsigned char* data, size_t length) {
+    for (; length; length--) {
+        crc = (crc << 8) ^ byteTable[(crc >> 8) ^ *data++];
+    }
+    return crc;
+}
+
+// CRC7 of a command, a bit at a time, in the low 7 bits as crc7() returns it
+static unsigned char crc7Bitwise(const unsigned char* data, size_t length) {
+    unsigned char crc = 0;
+    for (size_t i = 0; length > i; i++) {
+        for (int bit = 7; 0 <= bit; bit--) {
+            bool in = (data[i] >> bit & 1) ^ (crc >> 6 & 1);
+            crc = (crc << 1) & 0x7f;
+            crc ^= in ? 0x09 : 0;
+        }
+    }
+    return crc;
+}
+
+static void testCrcs(const std::vector<unsigned char>& data) {
+    const char* chars = (const char*)data.data();
+    for (int length = 0; MAX_LENGTH >= length; length++) {
+        uint16_t expected = sniffer(0, data.data(), length);
+        CHECK(expected == bytewise(0, data.data(), length));
+        CHECK(expected == crc16(chars, length));
+
+        // every split of the block between what came in with the token and what the sniffer sees,
+        // and the same split through update_crc16() (odd starts too, off the word boundary)
+        for (int ahead = 0; length >= ahead; ahead += 1 + ahead / 8) {
+            uint16_t seed = crc16(chars, ahead);
+            CHECK(expected == sniffer(seed, data.data() + ahead, length - ahead));
+            CHECK(expected == (update_crc16(&seed, chars + ahead, length - ahead), seed));
+        }
+    }
+    CHECK(0x31c3 == crc16("123456789", 9)); // the XMODEM check value
+
+    // CMD0 and CMD8 go out with these CRCs whether CRC is on or not
+    const unsigned char cmd0[5] = {0x40, 0, 0, 0, 0}, cmd8[5] = {0x48, 0, 0, 0x01, 0xaa};
+    CHECK(0x4a == crc7((const char*)cmd0, 5));
+    CHECK(0x43 == crc7((const char*)cmd8, 5));
+    for (int length = 0; 6 >= length; length++) {
+        for (int ofs = 0; 32 > ofs; ofs++) {
+            CHECK(crc7Bitwise(data.data() + ofs, length) == (unsigned char)crc7(chars + ofs, length));
+        }
+    }
+}
+
+// Returns the CRCs xor'd together so the loops can't be optimized away.
+static uint16_t bench(const char* name, const std::vector<unsigned char>& data, int blocks, bool sliced) {
+    uint16_t sum = 0;
+    int count = data.size() / BLOCK_SIZE;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; blocks > i; i++) {
+        const unsigned char* block = data.data() + i % count * BLOCK_SIZE;
+        sum ^= sliced ? crc16((const char*)block, BLOCK_SIZE) : bytewise(0, block, BLOCK_SIZE);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    printf("%-8s %.3f us a block, %.0f MB/s\n", name, us / blocks, (double)blocks * BLOCK_SIZE / us);
+    return sum;
+}
+
+int main(int argc, char** argv) {
+    int blocks = 1 < argc ? atoi(argv[1]) : DEFAULT_BLOCKS;
+    if (0 >= blocks) {
+        fprintf(stderr, "usage: crcBench [blocks]\n");
+        return 2;
+    }
+    for (int i = 0; 256 > i; i++) {
+        unsigned char byte = i;
+        byteTable[i] = sniffer(0, &byte, 1);
+    }
+    std::vector<unsigned char> data(64 * BLOCK_SIZE);
+    uint32_t seed = 1;
+    for (unsigned char& byte : data) {
+        seed = seed * 1103515245 + 12345;
+        byte = seed >> 16;
+    }
+
+    testCrcs(data);
+    uint16_t bytewiseSum = bench("bytewise", data, blocks, false);
+    uint16_t slicedSum = bench("slice-4", data, blocks, true);
+    CHECK(bytewiseSum == slicedSum);
+    return checkResult("crcBench");
+}
@@ -0,0 +1,66 @@
+// Re-lays .crv videos with sector aligned frames, see docs/fileFormat.md
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cardImage.h"
+#include "frameDecoding.h"
+
+#define SECTOR_SIZE 512
+
+static uint32_t readU32(const unsigned char* p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void writeU32(unsigned char* p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static size_t roundUp(size_t n) {
+    return (n + SECTOR_SIZE - 1) & ~(size_t)(SECTOR_SIZE - 1);
+}
+
+unsigned char* alignVideo(const unsigned char* data, size_t length, size_t* alignedLength, const char** why) {
+    if (length < 0x14 || memcmp(data, "CRV", 3)) {
+        *why = "not a .crv";
+        return NULL;
+    }
+    uint32_t numFrames = readU32(data + 0x4);
+    uint32_t firstFrame = readU32(data + 0x8);
+    if (data[3] < 1 || firstFrame < 0x14 || firstFrame > length) {
+        *why = "header has no flags, re-encode it";
+        return NULL;
+    }
+    uint32_t flags = readU32(data + 0x10);
+
+    // frames only grow by their padding, so this is always enough
+    size_t newFirst = roundUp(firstFrame);
+    unsigned char* out = calloc(1, newFirst + roundUp(length) + (size_t)numFrames * SECTOR_SIZE);
+    if (!out) {
+        *why = "out of memory";
+        return NULL;
+    }
+    memcpy(out, data, firstFrame);
+    writeU32(out + 0x8, newFirst);
+    writeU32(out + 0x10, flags | CRV_FLAG_SECTOR_ALIGNED | CRV_FLAG_CONTIGUOUS);
+
+    size_t pos = firstFrame;
+    size_t outPos = newFirst;
+    for (uint32_t i = 0; numFrames > i; i++) {
+        uint32_t frameLength = pos + 0x10 <= length ? readU32(data + pos + 0xC) : 0;
+        if (frameLength < 0x10 || pos + frameLength > length) {
+            free(out);
+            *why = "frame headers are corrupt";
+            return NULL;
+        }
+        memcpy(out + outPos, data + pos, frameLength);
+        outPos += roundUp(frameLength);
+        pos += (flags & CRV_FLAG_SECTOR_ALIGNED) ? roundUp(frameLength) : frameLength;
+    }
+    *alignedLength = outPos;
+    return out;
+}
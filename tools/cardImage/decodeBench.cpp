@@ -0,0 +1,350 @@
+// Times the player's frame decoding (frameDecoding.cpp) on the build machine, on a frame as big as a
+// frame buffer holds: unpacking packed and palette bursts into ready-to-send ones, rebuilding a delta
+// frame from the frame two back, and decompressing an LZ frame, set against how fast the emulated card
+// (cardBench's middling one, or as given) reads the compressed frame in. Each is checked against the
+// frame it was made from first. The build machine is a lot quicker than the RP2040, so the times are for
+// comparing encodings and decoder changes with each other (build with -DCMAKE_BUILD_TYPE=Release for
+// numbers worth comparing); unpackTime and lzDecodeTime next to fetchTime are the numbers on the player.
+//
+//   decodeBench [-clock MHz] [-access us] [-gap us] [frames]
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "cardImage.h"
+#include "check.h"
+#include "frameDecoding.h"
+#include "playerConfig.h"
+#include "videoFileReading.h"
+
+#define DEFAULT_FRAMES 200
+#define FRAME_BURSTS (73728 / 8) // a frame buffer's worth
+#define HOLD_EVERY 40 // one burst in this many is a hold
+#define GROUP_BURSTS (FRAME_BURSTS / 4)
+#define DELTA_RUN 32 // a delta frame changes runs of this many bursts, one run in DELTA_RUN_EVERY
+#define DELTA_RUN_EVERY 7
+#define DELTA_SCATTER 97 // and one burst in this many on its own
+#define SECTOR_SIZE 512
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_LAST_LITERALS 5
+
+typedef std::vector<unsigned char> Bytes;
+
+static Bytes frame(FRAME_BURSTS * 8);
+static unsigned char palette[FRAME_PALETTE_SIZE];
+
+// Bursts as the encoder makes them, the values moving slowly along the frame with the odd jump, and
+// a hold now and then. Values are kept to palette levels when there's a palette to stick to.
+static void makeFrame(Bytes& bursts, uint32_t seed, bool paletted) {
+    for (uint32_t i = 0; FRAME_BURSTS > i; i++) {
+        unsigned char* burst = &bursts[i * 8];
+        if (HOLD_EVERY - 1 == i % HOLD_EVERY) {
+            uint32_t slots = 1 + i % 700;
+            memset(burst, 0, 8);
+            burst[0] = HOLD_BURST;
+            burst[2] = slots;
+            burst[3] = slots >> 8;
+            continue;
+        }
+        for (int j = 0; 4 > j; j++) {
+            seed = seed * 1103515245 + 12345;
+            uint32_t value = (i / 16 + 40 * j + (0 == seed >> 28 ? seed >> 24 : 0)) & 0xff;
+            burst[2 * j] = ((6 * j + i % 6) + 0x10) << 1;
+            burst[2 * j + 1] = paletted ? palette[value >> 3] : value;
+        }
+    }
+}
+
+// Appends (channel, value) pairs of 5 + valueBits bits, least significant bit first, as the encoder packs.
+struct BitWriter {
+    Bytes& out;
+    uint32_t acc = 0;
+    int bits = 0;
+
+    BitWriter(Bytes& out) : out(out) {}
+
+    void put(uint32_t channel, uint32_t value, int valueBits) {
+        acc |= (channel | value << 5) << bits;
+        for (bits += 5 + valueBits; 8 <= bits; bits -= 8) {
+            out.push_back(acc);
+            acc >>= 8;
+        }
+    }
+
+    void flush() {
+        if (bits) {
+            out.push_back(acc);
+        }
+        acc = 0;
+        bits = 0;
+    }
+};
+
+static int levelOf(unsigned char value) {
+    for (int i = 0; FRAME_PALETTE_SIZE > i; i++) {
+        if (palette[i] == value) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Packs bursts with 8-bit values, or with 5-bit palette indices when paletted.
+static void packBursts(const unsigned char* bursts, uint32_t count, Bytes& out, bool paletted) {
+    int valueBits = paletted ? FRAME_PALETTE_BITS : 8;
+    BitWriter writer(out);
+    for (uint32_t i = 0; count > i; i++) {
+        const unsigned char* burst = bursts + i * 8;
+        if (HOLD_BURST == burst[0]) {
+            uint32_t slots = burst[2] | burst[3] << 8;
+            uint32_t mask = (1 << valueBits) - 1;
+            writer.put(31, slots & mask, valueBits);
+            writer.put(0, slots >> valueBits & mask, valueBits);
+            writer.put(0, slots >> (2 * valueBits) & mask, valueBits);
+            writer.put(0, 0, valueBits);
+            continue;
+        }
+        for (int j = 0; 4 > j; j++) {
+            uint32_t value = paletted ? levelOf(burst[2 * j + 1]) : burst[2 * j + 1];
+            writer.put((burst[2 * j] >> 1) - 0x10, value, valueBits);
+        }
+    }
+    writer.flush();
+}
+
+template <typename Decode>
+static double timeFrames(int frames, Decode decode) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; frames > i; i++) {
+        decode();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+}
+
+static void report(const char* name, double us, size_t stored) {
+    printf("%-8s %7.1f us a frame, %6.0f MB/s out, %6zu bytes stored for %zu (%.0f%%)\n", name, us,
+           frame.size() / us, stored, frame.size(), 100.0 * stored / frame.size());
+}
+
+// expandBursts on a packed frame and a palette frame, as the reader unpacks them after loadNewFrame().
+static void benchUnpack(int frames) {
+    Bytes out(frame.size());
+    for (bool paletted : {false, true}) {
+        Bytes bursts(frame.size()), packed;
+        makeFrame(bursts, 1, paletted);
+        packBursts(bursts.data(), FRAME_BURSTS, packed, paletted);
+        const unsigned char* levels = paletted ? palette : NULL;
+        int valueBits = paletted ? FRAME_PALETTE_BITS : 8;
+
+        expandBursts(packed.data(), out.data(), FRAME_BURSTS, valueBits, levels);
+        CHECK(out == bursts);
+        double us = timeFrames(frames, [&] { expandBursts(packed.data(), out.data(), FRAME_BURSTS, valueBits, levels); });
+        report(paletted ? "palette" : "packed", us, packed.size());
+    }
+}
+
+// The frame two back with some of it changed: runs where the picture moved, and single bursts here
+// and there. Holds stay as they are, the encoder only copies them when they match.
+static void changeFrame(const Bytes& ref, Bytes& bursts) {
+    bursts = ref;
+    for (uint32_t i = 0; FRAME_BURSTS > i; i++) {
+        unsigned char* burst = &bursts[i * 8];
+        if (HOLD_BURST != burst[0] && (0 == i / DELTA_RUN % DELTA_RUN_EVERY || 0 == i % DELTA_SCATTER)) {
+            for (int j = 0; 4 > j; j++) {
+                burst[2 * j + 1] ^= 0x20;
+            }
+        }
+    }
+}
+
+// Delta-codes a group against the same group of the reference as the encoder does, copying bursts that
+// match exactly.
+static void encodeDeltaGroup(const unsigned char* bursts, const unsigned char* ref, uint32_t count, Bytes& out,
+                             bool packed) {
+    for (uint32_t i = 0; count > i;) {
+        uint32_t copies = 0, literals = 0;
+        while (count > i + copies && 0 == memcmp(bursts + (i + copies) * 8, ref + (i + copies) * 8, 8)) {
+            copies++;
+        }
+        while (count > i + copies + literals &&
+               0 != memcmp(bursts + (i + copies + literals) * 8, ref + (i + copies + literals) * 8, 8)) {
+            literals++;
+        }
+        out.insert(out.end(), {(unsigned char)copies, (unsigned char)(copies >> 8), (unsigned char)literals,
+                               (unsigned char)(literals >> 8)});
+        const unsigned char* stored = bursts + (i + copies) * 8;
+        if (packed) {
+            packBursts(stored, literals, out, false);
+        } else {
+            out.insert(out.end(), stored, stored + literals * 8);
+        }
+        i += copies + literals;
+    }
+}
+
+// decodeDeltaGroup on each group of a delta frame against the frame two back, with raw and packed
+// literals, as the reader rebuilds a delta frame.
+static void benchDelta(int frames) {
+    Bytes bursts, out(frame.size());
+    changeFrame(frame, bursts);
+    for (bool packed : {false, true}) {
+        Bytes groups[4];
+        size_t stored = 0;
+        for (int g = 0; 4 > g; g++) {
+            encodeDeltaGroup(&bursts[g * GROUP_BURSTS * 8], &frame[g * GROUP_BURSTS * 8], GROUP_BURSTS, groups[g],
+                             packed);
+            stored += groups[g].size();
+        }
+        auto decode = [&] {
+            bool fits = true;
+            for (int g = 0; 4 > g; g++) {
+                fits = GROUP_BURSTS == decodeDeltaGroup(groups[g].data(), groups[g].size(), &frame[g * GROUP_BURSTS * 8],
+                                                        GROUP_BURSTS, &out[g * GROUP_BURSTS * 8], GROUP_BURSTS, packed) &&
+                       fits;
+            }
+            return fits;
+        };
+
+        CHECK(decode());
+        CHECK(out == bursts);
+        double us = timeFrames(frames, decode);
+        report(packed ? "delta+pk" : "delta", us, stored);
+    }
+}
+
+static void lzAppendLength(Bytes& out, uint32_t length) {
+    for (; 255 <= length; length -= 255) {
+        out.push_back(255);
+    }
+    out.push_back(length);
+}
+
+static void lzAppendSequence(Bytes& out, const unsigned char* literals, uint32_t literalCount, uint32_t offset,
+                             uint32_t matchLength) {
+    uint32_t matchCode = matchLength ? matchLength - LZ_MIN_MATCH : 0;
+    out.push_back((15 < literalCount ? 15 : literalCount) << 4 | (15 < matchCode ? 15 : matchCode));
+    if (15 <= literalCount) {
+        lzAppendLength(out, literalCount - 15);
+    }
+    out.insert(out.end(), literals, literals + literalCount);
+    if (matchLength) {
+        out.push_back(offset);
+        out.push_back(offset >> 8);
+        if (15 <= matchCode) {
+            lzAppendLength(out, matchCode - 15);
+        }
+    }
+}
+
+// The encoder's greedy LZ4 block compressor (lzCompress in lz.go).
+static void lzCompress(const Bytes& src, Bytes& out) {
+    std::vector<int32_t> table(1 << LZ_HASH_BITS, -1);
+    uint32_t anchor = 0, matchLimit = src.size() - LZ_LAST_LITERALS;
+    for (uint32_t pos = 0; matchLimit >= pos + LZ_MIN_MATCH;) {
+        uint32_t v;
+        memcpy(&v, &src[pos], 4);
+        uint32_t h = v * 2654435761u >> (32 - LZ_HASH_BITS);
+        int32_t candidate = table[h];
+        table[h] = pos;
+        if (0 > candidate || 0xffff < pos - candidate || 0 != memcmp(&src[candidate], &v, 4)) {
+            pos++;
+            continue;
+        }
+        uint32_t length = LZ_MIN_MATCH;
+        while (matchLimit > pos + length && src[candidate + length] == src[pos + length]) {
+            length++;
+        }
+        lzAppendSequence(out, &src[anchor], pos - anchor, pos - candidate, length);
+        pos += length;
+        anchor = pos;
+    }
+    lzAppendSequence(out, &src[anchor], src.size() - anchor, 0, 0);
+}
+
+// How long the emulated card takes to read bytes from the start of its image, in us.
+static uint64_t cardReadUs(uint32_t bytes) {
+    static Bytes buffer;
+    uint32_t sectors = (bytes + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    buffer.resize(sectors * SECTOR_SIZE);
+    uint64_t start = emulatedCardNow();
+    CHECK(0 == emulatedCardRead(NULL, buffer.data(), 0, sectors));
+    return emulatedCardNow() - start;
+}
+
+// lzDecode on a compressed frame, against reading it in off the emulated card. The reader decompresses
+// each sector while the next is on the bus, so decoding wants to be quicker than the card.
+static void benchLz(int frames, const EmulatedTiming& timing) {
+    Bytes block, out(frame.size());
+    lzCompress(frame, block);
+    auto decode = [&] {
+        LzDecoder lz;
+        lzBegin(&lz, block.data(), block.size(), out.data(), out.size());
+        return lzDecode(&lz, lz.inEnd);
+    };
+
+    CHECK(1 == decode());
+    CHECK(out == frame);
+    double us = timeFrames(frames, decode);
+    report("lz", us, block.size());
+
+    FILE* image = tmpfile();
+    if (!image) {
+        fprintf(stderr, "decodeBench: can't make a scratch card image\n");
+        failures++;
+        return;
+    }
+    Bytes sectors((frame.size() / SECTOR_SIZE + 1) * SECTOR_SIZE);
+    fwrite(sectors.data(), 1, sectors.size(), image);
+    fflush(image);
+    emulatedCardAttach(image, sectors.size() / SECTOR_SIZE, 8192, &timing);
+    uint64_t lzUs = cardReadUs(block.size());
+    emulatedCardAttach(image, sectors.size() / SECTOR_SIZE, 8192, &timing); // into the same AU change again
+    uint64_t rawUs = cardReadUs(frame.size());
+    fclose(image);
+
+    double decodeMBs = block.size() / us, cardMBs = (double)block.size() / lzUs;
+    printf("lz       decodes %.1f MB/s of compressed frame, the card reads %.1f MB/s: %s\n", decodeMBs, cardMBs,
+           decodeMBs > cardMBs ? "decoding keeps up with the card" : "decoding holds the card up");
+    uint64_t lzFrameUs = lzUs > us ? lzUs : (uint64_t)us; // overlapped, so whichever is slower
+    printf("lz       a frame is in after %llu us compressed, %llu us raw\n", (unsigned long long)lzFrameUs,
+           (unsigned long long)rawUs);
+}
+
+static void usage() {
+    fprintf(stderr, "usage: decodeBench [-clock MHz] [-access us] [-gap us] [frames]\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    EmulatedTiming timing = {25 * 1000 * 1000, 300, 20, 1000, 0, 0}; // cardBench's middling card
+    int arg = 1;
+    for (; argc > arg + 1 && '-' == argv[arg][0]; arg += 2) {
+        uint32_t value = strtoul(argv[arg + 1], NULL, 10);
+        if (0 == strcmp(argv[arg], "-clock")) {
+            timing.clockHz = value * 1000 * 1000;
+        } else if (0 == strcmp(argv[arg], "-access")) {
+            timing.accessUs = value;
+        } else if (0 == strcmp(argv[arg], "-gap")) {
+            timing.blockGapUs = value;
+        } else {
+            usage();
+        }
+    }
+    int frames = argc > arg ? atoi(argv[arg]) : DEFAULT_FRAMES;
+    if (argc > arg + 1 || 0 >= frames || 0 == timing.clockHz) {
+        usage();
+    }
+    for (int i = 0; FRAME_PALETTE_SIZE > i; i++) {
+        palette[i] = 8 * i + 4;
+    }
+    makeFrame(frame, 1, false);
+
+    benchUnpack(frames);
+    benchDelta(frames);
+    benchLz(frames, timing);
+    return checkResult("decodeBench");
+}
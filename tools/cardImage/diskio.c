@@ -0,0 +1,64 @@
+// FatFs disk functions backed by the image file being built. Drive 0 is the only drive.
+#include <stdio.h>
+
+#include "ff.h"
+#include "diskio.h"
+
+#include "cardImage.h"
+
+static FILE* image;
+static LBA_t imageSectors;
+static DWORD auSectors = 1;
+
+void imageAttach(FILE* file, LBA_t sectors, DWORD au) {
+    image = file;
+    imageSectors = sectors;
+    auSectors = au;
+}
+
+DSTATUS disk_initialize(BYTE pdrv) {
+    return disk_status(pdrv);
+}
+
+DSTATUS disk_status(BYTE pdrv) {
+    return (0 == pdrv && image) ? 0 : STA_NOINIT;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE* buff, LBA_t sector, UINT count) {
+    if (0 != pdrv || !image || sector + count > imageSectors) {
+        return RES_PARERR;
+    }
+    if (0 != fseeko(image, (off_t)sector * FF_MAX_SS, SEEK_SET) || count != fread(buff, FF_MAX_SS, count, image)) {
+        return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE* buff, LBA_t sector, UINT count) {
+    if (0 != pdrv || !image || sector + count > imageSectors) {
+        return RES_PARERR;
+    }
+    if (0 != fseeko(image, (off_t)sector * FF_MAX_SS, SEEK_SET) || count != fwrite(buff, FF_MAX_SS, count, image)) {
+        return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff) {
+    if (0 != pdrv || !image) {
+        return RES_PARERR;
+    }
+    switch (cmd) {
+        case CTRL_SYNC:
+            return 0 == fflush(image) ? RES_OK : RES_ERROR;
+        case GET_SECTOR_COUNT:
+            *(LBA_t*)buff = imageSectors;
+            return RES_OK;
+        case GET_BLOCK_SIZE:
+            // f_mkfs lines the data area up with this, so clusters sit in whole allocation units
+            *(DWORD*)buff = auSectors;
+            return RES_OK;
+        default:
+            return RES_PARERR;
+    }
+}
@@ -0,0 +1,525 @@
+// cardBench's SD card emulator: card images read through a model of how long an SD card on SPI takes to
+// read them. Each card works through its reads on its own, so two cards read at once take as long as the
+// slower one, and the clock only moves on when something waits for a card. Writes (the benchmark's results)
+// go straight to the image and take no time.
+//
+// Cards can also be talked to a byte at a time over SPI (emulatedCardExchange), for running the player's
+// own SD driver on them: bring-up, CMD6 high speed, and the clock limit its baud rate ramp runs into.
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ff.h"
+
+#include "cardImage.h"
+
+#define SECTOR_SIZE 512
+#define COMMAND_BYTES 8 // command, the wait for its response and the response
+#define BLOCK_BYTES (1 + SECTOR_SIZE + 2) // start token, data and CRC
+
+#define DEFAULT_SPEED_HZ (25 * 1000 * 1000)
+#define HIGH_SPEED_HZ (50 * 1000 * 1000)
+#define INIT_COMMANDS 3 // ACMD41s until the card is ready
+#define START_BLOCK 0xfe
+#define NO_BLOCK UINT64_MAX // the block to send is the register in reg, not a sector
+
+typedef struct {
+    FILE* image;
+    LBA_t imageSectors;
+    DWORD auSectors;
+    EmulatedTiming timing;
+    uint64_t busNs; // bus time not yet a whole microsecond
+    uint64_t lastAu;
+    uint32_t stallSeed;
+    uint64_t freeAt; // when the card is done with the last read
+
+    // the read in progress
+    bool busy;
+    uint8_t* buffer;
+    uint64_t sector;
+    uint32_t count;
+    uint32_t firstRun, run, gap; // where the sectors land in buffer, see disk_read_async_strided
+    uint32_t done;
+    uint64_t nextAt; // when the next sector lands, or when the read ends once they all have
+    uint64_t lateAt; // when the read runs out of budget, 0 for never
+
+    // the SPI side
+    bool selected;
+    bool spiMode; // CMD0 came with the card selected
+    bool idle; // not through ACMD41 yet
+    bool crcOn;
+    bool appCommand; // CMD55 came last
+    bool highSpeed;
+    int initCommands;
+    uint8_t command[6];
+    int commandBytes;
+    uint8_t out[BLOCK_BYTES]; // what goes out next, then waitBytes of 0xff, then the block
+    int outLength, outPos;
+    uint32_t waitBytes;
+    bool blockPending;
+    uint64_t blockSector; // NO_BLOCK for reg
+    bool streaming; // CMD18, blocks keep coming until CMD12
+    uint8_t reg[64]; // CSD, SD status or switch status
+    int regLength;
+} EmulatedCard;
+
+static EmulatedCard cards[EMULATED_CARDS];
+static uint64_t nowUs;
+static uint64_t spiNs; // SPI time not yet a whole microsecond
+static int busyCards;
+static int mostBusyCards;
+
+void emulatedCardAttachDrive(BYTE pdrv, FILE* file, LBA_t sectors, DWORD au, const EmulatedTiming* t) {
+    EmulatedCard* card = &cards[pdrv];
+    card->image = file;
+    card->imageSectors = sectors;
+    card->auSectors = au;
+    card->timing = *t;
+    card->busNs = 0;
+    card->lastAu = UINT64_MAX;
+    card->stallSeed = 1;
+    card->freeAt = nowUs;
+    card->busy = false;
+    memset(&card->selected, 0, sizeof(EmulatedCard) - offsetof(EmulatedCard, selected)); // powered up again
+}
+
+void emulatedCardAttach(FILE* file, LBA_t sectors, DWORD au, const EmulatedTiming* t) {
+    emulatedCardAttachDrive(0, file, sectors, au, t);
+}
+
+FILE* emulatedCardImage(BYTE pdrv, LBA_t* sectors, DWORD* au) {
+    if (pdrv >= EMULATED_CARDS) {
+        return NULL;
+    }
+    *sectors = cards[pdrv].imageSectors;
+    *au = cards[pdrv].auSectors;
+    return cards[pdrv].image;
+}
+
+uint64_t emulatedCardNow() {
+    return nowUs;
+}
+
+void emulatedCardWait(uint32_t us) {
+    nowUs += us;
+}
+
+int emulatedCardsMostBusy() {
+    return mostBusyCards;
+}
+
+static uint64_t busTime(EmulatedCard* card, uint32_t bytes) {
+    card->busNs += (uint64_t)bytes * 8 * 1000000000 / card->timing.clockHz;
+    uint64_t us = card->busNs / 1000;
+    card->busNs %= 1000;
+    return us;
+}
+
+// When the card has the block after done ready, going on from at.
+static uint64_t blockTime(EmulatedCard* card, uint64_t at) {
+    uint64_t au = (card->sector + card->done) / card->auSectors;
+    if (au != card->lastAu) {
+        at += card->timing.auChangeUs;
+        card->lastAu = au;
+    }
+    if (card->timing.stallEvery) {
+        card->stallSeed = card->stallSeed * 1103515245 + 12345; // the same stalls every run
+        if (0 == (card->stallSeed >> 8) % card->timing.stallEvery) {
+            at += card->timing.stallUs;
+        }
+    }
+    if (card->done) {
+        at += card->timing.blockGapUs;
+    }
+    return at + busTime(card, BLOCK_BYTES);
+}
+
+static uint32_t landingOffset(const EmulatedCard* card, uint32_t block) {
+    if (block < card->firstRun) {
+        return block * SECTOR_SIZE;
+    }
+    uint32_t runs = (block - card->firstRun) / card->run;
+    return (card->firstRun + runs * card->run + (block - card->firstRun) % card->run) * SECTOR_SIZE +
+           (runs + 1) * card->gap;
+}
+
+static void endRead(EmulatedCard* card, uint64_t at) {
+    card->busy = false;
+    card->freeAt = at;
+    busyCards--;
+}
+
+int emulatedCardStart(BYTE pdrv, uint8_t* buffer, uint64_t sector, uint32_t count, uint32_t firstRun, uint32_t run,
+                      uint32_t gap, uint32_t budgetUs) {
+    if (pdrv >= EMULATED_CARDS) {
+        return -1;
+    }
+    EmulatedCard* card = &cards[pdrv];
+    if (!card->image || card->busy || 0 == count || sector + count > card->imageSectors) {
+        return -1;
+    }
+    uint64_t start = card->freeAt > nowUs ? card->freeAt : nowUs;
+    card->buffer = buffer;
+    card->sector = sector;
+    card->count = count;
+    card->firstRun = firstRun ? firstRun : count;
+    card->run = run ? run : count;
+    card->gap = gap;
+    card->done = 0;
+    card->lateAt = budgetUs ? nowUs + budgetUs : 0;
+    card->nextAt = blockTime(card, start + busTime(card, COMMAND_BYTES) + card->timing.accessUs);
+    card->busy = true;
+    if (++busyCards > mostBusyCards) {
+        mostBusyCards = busyCards;
+    }
+    return 0;
+}
+
+int emulatedCardPoll(BYTE pdrv, int* result, uint32_t* done) {
+    EmulatedCard* card = &cards[pdrv];
+    if (!card->busy) {
+        *result = -1;
+        return 1;
+    }
+    if (card->lateAt && card->nextAt > card->lateAt && nowUs >= card->lateAt) {
+        endRead(card, card->lateAt); // the driver gives up on the card here
+        *result = 1;
+        return 1;
+    }
+    if (nowUs < card->nextAt) {
+        // nothing else can happen on this card until then, so that is how long polling takes
+        nowUs = card->lateAt && card->lateAt < card->nextAt ? card->lateAt : card->nextAt;
+    }
+    while (card->done < card->count && nowUs >= card->nextAt) {
+        uint8_t* out = card->buffer + landingOffset(card, card->done);
+        if (0 != fseeko(card->image, (off_t)(card->sector + card->done) * SECTOR_SIZE, SEEK_SET) ||
+            1 != fread(out, SECTOR_SIZE, 1, card->image)) {
+            endRead(card, nowUs);
+            *result = -1;
+            return 1;
+        }
+        card->done++;
+        if (card->done < card->count) {
+            card->nextAt = blockTime(card, card->nextAt);
+        } else if (card->count > 1) {
+            card->nextAt += busTime(card, COMMAND_BYTES + 1); // CMD12, and the busy byte after it
+        }
+    }
+    if (done) {
+        *done = card->done;
+    }
+    if (card->done == card->count && nowUs >= card->nextAt) {
+        endRead(card, card->nextAt);
+        *result = 0;
+        return 1;
+    }
+    return 0;
+}
+
+int emulatedCardRead(void* card, uint8_t* buffer, uint64_t sector, uint32_t count) {
+    (void)card; // the benchmark only has the one
+    if (0 != emulatedCardStart(0, buffer, sector, count, 0, 0, 0, 0)) {
+        return -1;
+    }
+    int result;
+    while (!emulatedCardPoll(0, &result, NULL)) {
+    }
+    return result;
+}
+
+bool emulatedCardHighSpeed(BYTE pdrv) {
+    return cards[pdrv].highSpeed;
+}
+
+// CRCs the card checks commands with and sends after data, worked out here rather than with the
+// driver's crc.c so a mistake there shows up
+static uint8_t crc7(const uint8_t* data, int length) {
+    uint8_t crc = 0;
+    for (int i = 0; length > i; i++) {
+        for (int bit = 7; 0 <= bit; bit--) {
+            bool top = ((crc >> 6) ^ (data[i] >> bit)) & 1;
+            crc = (crc << 1) & 0x7f;
+            if (top) {
+                crc ^= 0x09;
+            }
+        }
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t* data, int length) {
+    uint16_t crc = 0;
+    for (int i = 0; length > i; i++) {
+        crc ^= data[i] << 8;
+        for (int bit = 0; 8 > bit; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// The fastest SCK the card reads cleanly at in the speed mode it's in.
+static uint32_t clockLimit(const EmulatedCard* card) {
+    uint32_t limit = card->highSpeed ? HIGH_SPEED_HZ : DEFAULT_SPEED_HZ;
+    if (card->timing.maxClockHz && card->timing.maxClockHz < limit) {
+        limit = card->timing.maxClockHz;
+    }
+    return limit;
+}
+
+static uint32_t bytesFor(uint32_t us, uint32_t clockHz) {
+    return (uint64_t)us * clockHz / 8 / 1000000;
+}
+
+// Queues a response: the byte of NCR the driver expects, then R1 and whatever follows it.
+static void respond(EmulatedCard* card, const uint8_t* bytes, int length) {
+    card->out[0] = 0xff;
+    memcpy(card->out + 1, bytes, length);
+    card->outLength = 1 + length;
+    card->outPos = 0;
+}
+
+static void respondR1(EmulatedCard* card, uint8_t r1) {
+    respond(card, &r1, 1);
+}
+
+// Sends the register in reg as a data block after the response.
+static void sendRegister(EmulatedCard* card, int length, uint32_t clockHz) {
+    card->regLength = length;
+    card->blockSector = NO_BLOCK;
+    card->blockPending = true;
+    card->waitBytes = bytesFor(card->timing.blockGapUs, clockHz);
+}
+
+static void sendSectors(EmulatedCard* card, uint64_t sector, bool multiple, uint32_t clockHz) {
+    uint32_t us = card->timing.accessUs;
+    if (sector / card->auSectors != card->lastAu) {
+        us += card->timing.auChangeUs;
+        card->lastAu = sector / card->auSectors;
+    }
+    card->blockSector = sector;
+    card->blockPending = true;
+    card->streaming = multiple;
+    card->waitBytes = bytesFor(us, clockHz);
+}
+
+// The block after the response, start token and CRC included. Past the clock limit the card's timing
+// is off and a bit comes back wrong, which the CRC (or comparing reads) catches.
+static void loadBlock(EmulatedCard* card, uint32_t clockHz) {
+    uint8_t* data = card->out + 1;
+    int length = card->regLength;
+    if (NO_BLOCK != card->blockSector) {
+        length = SECTOR_SIZE;
+        if (0 != fseeko(card->image, (off_t)card->blockSector * SECTOR_SIZE, SEEK_SET) ||
+            1 != fread(data, SECTOR_SIZE, 1, card->image)) {
+            memset(data, 0, SECTOR_SIZE);
+        }
+    } else {
+        memcpy(data, card->reg, length);
+    }
+    uint16_t crc = crc16(data, length);
+    card->out[0] = START_BLOCK;
+    data[length] = crc >> 8;
+    data[length + 1] = crc;
+    if (clockHz > clockLimit(card)) {
+        data[length / 3] ^= 0x10;
+    }
+    card->outLength = 1 + length + 2;
+    card->outPos = 0;
+
+    card->blockPending = false;
+    if (card->streaming && card->blockSector + 1 < card->imageSectors) {
+        card->blockSector++;
+        card->blockPending = true;
+        card->waitBytes = bytesFor(card->timing.blockGapUs, clockHz);
+    }
+}
+
+static uint8_t nextOut(EmulatedCard* card, uint32_t clockHz) {
+    if (card->outPos == card->outLength) {
+        if (card->waitBytes) {
+            card->waitBytes--;
+            return 0xff;
+        }
+        if (!card->blockPending) {
+            return 0xff;
+        }
+        loadBlock(card, clockHz);
+    }
+    return card->out[card->outPos++];
+}
+
+// CSD version 2.0, for a high capacity card the size of the image.
+static void makeCsd(EmulatedCard* card) {
+    uint32_t size = card->imageSectors / 1024 - 1;
+    uint8_t csd[16] = {0x40, 0x0e, 0x00, card->highSpeed ? 0x5a : 0x32, 0x5b, 0x59, 0x00,
+                       (size >> 16) & 0x3f, size >> 8, size, 0x7f, 0x80, 0x0a, 0x40, 0x00, 0x00};
+    csd[15] = crc7(csd, 15) << 1 | 1;
+    memcpy(card->reg, csd, sizeof(csd));
+}
+
+// The SD status, of which the driver only wants the allocation unit.
+static void makeSdStatus(EmulatedCard* card) {
+    static const uint32_t auSectors[16] = {0, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 24576,
+                                           32768, 49152, 65536, 131072};
+    memset(card->reg, 0, 64);
+    for (int code = 1; 16 > code; code++) {
+        if (auSectors[code] == card->auSectors) {
+            card->reg[10] = code << 4;
+        }
+    }
+}
+
+// The switch status CMD6 sends back, with group 1 (access mode) the only group anything happens in.
+static void makeSwitchStatus(EmulatedCard* card, uint32_t arg) {
+    bool wantsHighSpeed = 0x1 == (arg & 0xf);
+    bool switches = wantsHighSpeed && card->timing.highSpeed;
+    memset(card->reg, 0, 64);
+    card->reg[1] = 100; // mA
+    card->reg[13] = 0x01 | (card->timing.highSpeed ? 0x02 : 0x00); // default and maybe high speed
+    card->reg[16] = !wantsHighSpeed ? (card->highSpeed ? 0x1 : 0x0) : switches ? 0x1 : 0xf;
+    if (switches && (arg & 0x80000000)) {
+        card->highSpeed = true;
+    }
+}
+
+static void runCommand(EmulatedCard* card, uint32_t clockHz) {
+    uint8_t index = card->command[0] & 0x3f;
+    uint32_t arg = (uint32_t)card->command[1] << 24 | card->command[2] << 16 | card->command[3] << 8 | card->command[4];
+    bool app = card->appCommand;
+    card->appCommand = false;
+    if (!card->spiMode && 0 != index) {
+        return; // still in SD mode, where this model doesn't go
+    }
+
+    bool stopping = 12 == index && card->streaming;
+    card->outLength = card->outPos = 0;
+    card->waitBytes = 0;
+    card->blockPending = false;
+    card->streaming = false;
+    if ((card->crcOn || 0 == index || 8 == index) && crc7(card->command, 5) != card->command[5] >> 1) {
+        respondR1(card, (card->idle ? 0x01 : 0x00) | 0x08);
+        return;
+    }
+    if (0 == index) {
+        card->spiMode = true;
+        card->idle = true;
+        card->crcOn = false;
+        card->highSpeed = false;
+        card->initCommands = 0;
+    }
+    uint8_t r1 = card->idle ? 0x01 : 0x00;
+    if (app) {
+        switch (index) {
+            case 41:
+                if (INIT_COMMANDS <= ++card->initCommands) {
+                    card->idle = false;
+                }
+                respondR1(card, card->idle ? 0x01 : 0x00);
+                return;
+            case 13: {
+                uint8_t r2[2] = {r1, 0x00};
+                respond(card, r2, 2);
+                makeSdStatus(card);
+                sendRegister(card, 64, clockHz);
+                return;
+            }
+            default:
+                respondR1(card, r1 | 0x04);
+                return;
+        }
+    }
+    switch (index) {
+        case 0:
+        case 16:
+            respondR1(card, 16 == index && SECTOR_SIZE != arg ? r1 | 0x40 : r1);
+            break;
+        case 6:
+            respondR1(card, r1);
+            makeSwitchStatus(card, arg);
+            sendRegister(card, 64, clockHz);
+            break;
+        case 8: {
+            uint8_t r7[5] = {r1, 0x00, 0x00, (arg >> 8) & 0xf, arg};
+            respond(card, r7, 5);
+            break;
+        }
+        case 9:
+            respondR1(card, r1);
+            makeCsd(card);
+            sendRegister(card, 16, clockHz);
+            break;
+        case 12:
+            if (stopping) {
+                uint8_t r1b[4] = {0xff, r1, 0x00, 0x00}; // a stuff byte first, then busy for a bit
+                memcpy(card->out, r1b, sizeof(r1b));
+                card->outLength = sizeof(r1b);
+            } else {
+                respondR1(card, r1 | 0x04);
+            }
+            break;
+        case 13: {
+            uint8_t r2[2] = {r1, 0x00};
+            respond(card, r2, 2);
+            break;
+        }
+        case 17:
+        case 18:
+            if (arg >= card->imageSectors) {
+                respondR1(card, r1 | 0x20);
+            } else {
+                respondR1(card, r1);
+                sendSectors(card, arg, 18 == index, clockHz);
+            }
+            break;
+        case 55:
+            card->appCommand = true;
+            respondR1(card, r1);
+            break;
+        case 58: {
+            uint32_t ocr = 0x00ff8000 | (card->idle ? 0 : 0xc0000000); // 2.7-3.6V, and powered up with CCS
+            uint8_t r3[5] = {r1, ocr >> 24, ocr >> 16, ocr >> 8, ocr};
+            respond(card, r3, 5);
+            break;
+        }
+        case 59:
+            card->crcOn = arg & 1;
+            respondR1(card, r1);
+            break;
+        default:
+            respondR1(card, r1 | 0x04);
+            break;
+    }
+}
+
+void emulatedCardSelect(BYTE pdrv, bool selected) {
+    EmulatedCard* card = &cards[pdrv];
+    if (!selected) {
+        // the driver sends CMD12 before letting go mid-read, anything else is dropped
+        card->commandBytes = 0;
+        card->outLength = card->outPos = 0;
+        card->waitBytes = 0;
+        card->blockPending = false;
+        card->streaming = false;
+    }
+    card->selected = selected;
+}
+
+uint8_t emulatedCardExchange(BYTE pdrv, uint8_t mosi, uint32_t clockHz) {
+    EmulatedCard* card = &cards[pdrv];
+    spiNs += 8000000000ull / clockHz;
+    nowUs += spiNs / 1000;
+    spiNs %= 1000;
+    if (!card->selected) {
+        return 0xff;
+    }
+    uint8_t miso = nextOut(card, clockHz);
+    if (card->commandBytes || 0x40 == (mosi & 0xc0)) {
+        card->command[card->commandBytes++] = mosi;
+        if (6 == card->commandBytes) {
+            card->commandBytes = 0;
+            runCommand(card, clockHz);
+        }
+    }
+    return miso;
+}
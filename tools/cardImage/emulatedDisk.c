@@ -0,0 +1,108 @@
+// The FatFs disk functions, and the player's async ones from diskio_async.h, on the emulated cards
+// (emulatedCard.c). Drive n is card n.
+#include <stdio.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "diskio_async.h"
+
+#include "cardImage.h"
+
+#define SECTOR_SIZE 512
+
+static UINT budgets[EMULATED_CARDS];
+
+static FILE* imageOf(BYTE pdrv, LBA_t* sectors, DWORD* au) {
+    LBA_t s;
+    DWORD a;
+    return emulatedCardImage(pdrv, sectors ? sectors : &s, au ? au : &a);
+}
+
+DSTATUS disk_initialize(BYTE pdrv) {
+    return disk_status(pdrv);
+}
+
+DSTATUS disk_status(BYTE pdrv) {
+    return imageOf(pdrv, NULL, NULL) ? 0 : STA_NOINIT;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE* buff, LBA_t sector, UINT count) {
+    if (!imageOf(pdrv, NULL, NULL)) {
+        return RES_PARERR;
+    }
+    DRESULT res = disk_read_async(pdrv, buff, sector, count);
+    return RES_OK == res ? disk_read_wait(pdrv) : res;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE* buff, LBA_t sector, UINT count) {
+    LBA_t sectors;
+    FILE* image = imageOf(pdrv, &sectors, NULL);
+    if (!image || sector + count > sectors) {
+        return RES_PARERR;
+    }
+    if (0 != fseeko(image, (off_t)sector * SECTOR_SIZE, SEEK_SET) || count != fwrite(buff, SECTOR_SIZE, count, image)) {
+        return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff) {
+    LBA_t sectors;
+    DWORD au;
+    FILE* image = imageOf(pdrv, &sectors, &au);
+    if (!image) {
+        return RES_PARERR;
+    }
+    switch (cmd) {
+        case CTRL_SYNC:
+            return 0 == fflush(image) ? RES_OK : RES_ERROR;
+        case GET_SECTOR_COUNT:
+            *(LBA_t*)buff = sectors;
+            return RES_OK;
+        case GET_BLOCK_SIZE:
+            *(DWORD*)buff = au;
+            return RES_OK;
+        default:
+            return RES_PARERR;
+    }
+}
+
+void disk_read_budget(BYTE pdrv, UINT budget_us) {
+    if (pdrv < EMULATED_CARDS) {
+        budgets[pdrv] = budget_us;
+    }
+}
+
+DRESULT disk_read_async_strided(BYTE pdrv, BYTE* buff, LBA_t sector, UINT count, UINT first_run, UINT run, UINT gap) {
+    if (!imageOf(pdrv, NULL, NULL)) {
+        return RES_PARERR;
+    }
+    if (0 != emulatedCardStart(pdrv, buff, sector, count, first_run, run, gap, budgets[pdrv])) {
+        return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+DRESULT disk_read_async(BYTE pdrv, BYTE* buff, LBA_t sector, UINT count) {
+    return disk_read_async_strided(pdrv, buff, sector, count, count, count, 0);
+}
+
+bool disk_read_poll(BYTE pdrv, DRESULT* result, UINT* sectors_done) {
+    int res;
+    uint32_t done = 0;
+    if (!emulatedCardPoll(pdrv, &res, &done)) {
+        if (sectors_done) {
+            *sectors_done = done;
+        }
+        return false;
+    }
+    *result = 0 == res ? RES_OK : 1 == res ? RES_LATE : RES_ERROR;
+    return true;
+}
+
+DRESULT disk_read_wait(BYTE pdrv) {
+    DRESULT result;
+    while (!disk_read_poll(pdrv, &result, NULL)) {
+    }
+    return result;
+}
@@ -0,0 +1,159 @@
+// The SPI layer under the player's SD driver (FatFs_SPI's spi.h, and the SDK's SPI and GPIO bits it
+// uses), on the emulated cards' SPI side. Transfers are done a byte at a time the moment they're
+// started, with the DMA sniffer's CRC worked out as the bytes come in.
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+#include "my_debug.h"
+#include "spi.h"
+
+#include "cardImage.h"
+
+#define PINS 30
+
+spi_inst_t emulatedSpis[2];
+
+static struct {
+    spi_inst_t* spi; // NULL if not wired up
+    uint csPin;
+} wiring[EMULATED_CARDS];
+static bool pins[PINS];
+
+void emulatedSpiWire(BYTE pdrv, struct spi_inst* spi, unsigned csPin) {
+    wiring[pdrv].spi = spi;
+    wiring[pdrv].csPin = csPin;
+    pins[csPin] = true;
+    emulatedCardSelect(pdrv, false);
+}
+
+void gpio_put(uint gpio, bool value) {
+    pins[gpio] = value;
+    for (BYTE pdrv = 0; EMULATED_CARDS > pdrv; pdrv++) {
+        if (wiring[pdrv].spi && wiring[pdrv].csPin == gpio) {
+            emulatedCardSelect(pdrv, !value);
+        }
+    }
+}
+
+bool gpio_get(uint gpio) {
+    return pins[gpio];
+}
+
+uint spi_set_baudrate(spi_inst_t* spi, uint baudrate) {
+    uint32_t in = clock_get_hz(clk_peri);
+    uint prescale = 2;
+    for (; 254 >= prescale; prescale += 2) {
+        if (in < (prescale + 2) * 256 * (uint64_t)baudrate) {
+            break;
+        }
+    }
+    uint postdiv = 256;
+    for (; 1 < postdiv; postdiv--) {
+        if (in / (prescale * (postdiv - 1)) > baudrate) {
+            break;
+        }
+    }
+    spi->baudrate = in / (prescale * postdiv);
+    return spi->baudrate;
+}
+
+// One byte each way with the card that's selected on the SPI. With none selected the clock still
+// runs, and MISO floats high.
+static uint8_t exchange(spi_inst_t* spi, uint8_t mosi) {
+    int clocked = -1;
+    for (BYTE pdrv = 0; EMULATED_CARDS > pdrv; pdrv++) {
+        if (spi == wiring[pdrv].spi && (0 > clocked || !pins[wiring[pdrv].csPin])) {
+            clocked = pdrv;
+        }
+    }
+    return 0 > clocked ? 0xff : emulatedCardExchange(clocked, mosi, spi->baudrate);
+}
+
+int spi_write_blocking(spi_inst_t* spi, const uint8_t* src, size_t len) {
+    for (size_t i = 0; len > i; i++) {
+        exchange(spi, src[i]);
+    }
+    return len;
+}
+
+bool spi_transfer(spi_t* pSPI, const uint8_t* tx, uint8_t* rx, size_t length) {
+    for (size_t i = 0; length > i; i++) {
+        uint8_t miso = exchange(pSPI->hw_inst, tx ? tx[i] : SPI_FILL_CHAR);
+        if (rx) {
+            rx[i] = miso;
+        }
+    }
+    pSPI->rx_crc_valid = false;
+    return true;
+}
+
+bool spi_transfer_start(spi_t* pSPI, const uint8_t* tx, uint8_t* rx, size_t length) {
+    spi_transfer(pSPI, tx, rx, length);
+    pSPI->xfer_pending = true;
+    pSPI->sniffing = false;
+    return true;
+}
+
+// CRC-16/XMODEM carried on from seed, as the sniffer computes it
+bool spi_transfer_start_crc(spi_t* pSPI, uint8_t* rx, size_t length, uint16_t seed) {
+    spi_transfer_start(pSPI, NULL, rx, length);
+    uint16_t crc = seed;
+    for (size_t i = 0; length > i; i++) {
+        crc ^= rx[i] << 8;
+        for (int bit = 0; 8 > bit; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    pSPI->rx_crc = crc;
+    pSPI->sniffing = true;
+    return true;
+}
+
+bool spi_transfer_is_complete(spi_t* pSPI) {
+    if (pSPI->xfer_pending) {
+        pSPI->xfer_pending = false;
+        pSPI->rx_crc_valid = pSPI->sniffing;
+        pSPI->sniffing = false;
+        if (pSPI->xfer_done_cb) {
+            pSPI->xfer_done_cb(pSPI->xfer_done_ctx);
+        }
+    }
+    return true;
+}
+
+bool spi_transfer_wait_complete(spi_t* pSPI, uint32_t timeout_ms) {
+    return spi_transfer_is_complete(pSPI);
+}
+
+void spi_set_transfer_callback(spi_t* pSPI, void (*cb)(void* context), void* context) {
+    pSPI->xfer_done_cb = cb;
+    pSPI->xfer_done_ctx = context;
+}
+
+void spi_lock(spi_t* pSPI) {}
+void spi_unlock(spi_t* pSPI) {}
+
+bool my_spi_init(spi_t* pSPI) {
+    spi_set_baudrate(pSPI->hw_inst, pSPI->baud_rate);
+    pSPI->initialized = true;
+    return true;
+}
+
+void set_spi_dma_irq_channel(bool useChannel1, bool shared) {}
+
+// the driver's debug output, which only shows when a check fails
+void my_printf(const char* pcFormat, ...) {
+    va_list args;
+    va_start(args, pcFormat);
+    vprintf(pcFormat, args);
+    va_end(args);
+}
+
+void my_assert_func(const char* file, int line, const char* func, const char* pred) {
+    fprintf(stderr, "%s:%d: %s: assertion %s failed\n", file, line, func, pred);
+    abort();
+}
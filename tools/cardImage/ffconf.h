@@ -0,0 +1,57 @@
+/*---------------------------------------------------------------------------/
+/  FatFs configuration for cardImage
+/
+/  A host build writing one image file: everything the player's configuration
+/  (FatFs_SPI/ff15/source/ffconf.h) has, plus f_expand for contiguous files and
+/  a fixed timestamp so the same inputs always give the same image. cardBench and
+/  the host checks share it.
+/---------------------------------------------------------------------------*/
+
+#define FFCONF_DEF	80286	/* Revision ID */
+
+#define FF_FS_READONLY	0
+#define FF_FS_MINIMIZE	0
+#define FF_USE_FIND		0
+#define FF_USE_MKFS		1
+#define FF_USE_FASTSEEK	1
+#define FF_USE_EXPAND	1
+#define FF_USE_CHMOD	0
+#define FF_USE_LABEL	0
+#define FF_USE_FORWARD	0
+#define FF_USE_STRFUNC	1	/* f_puts, for cardBench's results */
+#define FF_PRINT_LLI	0
+#define FF_PRINT_FLOAT	0
+#define FF_STRF_ENCODE	0
+
+#define FF_CODE_PAGE	437
+
+#define FF_USE_LFN		1
+#define FF_MAX_LFN		255
+#define FF_LFN_UNICODE	0
+#define FF_LFN_BUF		255
+#define FF_SFN_BUF		12
+#define FF_FS_RPATH		0
+
+#define FF_VOLUMES		1
+#define FF_STR_VOLUME_ID	0
+#define FF_VOLUME_STRS		"RAM","NAND","CF","SD","SD2","USB","USB2","USB3"
+#define FF_MULTI_PARTITION	0
+
+#define FF_MIN_SS		512
+#define FF_MAX_SS		512
+#define FF_LBA64		1
+#define FF_MIN_GPT		0x10000000
+#define FF_USE_TRIM		0
+
+#define FF_FS_TINY		0
+#define FF_FS_EXFAT		1
+#define FF_FS_NORTC		1	/* every file gets the date below, images are reproducible */
+#define FF_NORTC_MON	1
+#define FF_NORTC_MDAY	1
+#define FF_NORTC_YEAR	2022
+#define FF_FS_NOFSINFO	0
+#define FF_FS_LOCK		0
+#define FF_FS_REENTRANT	0
+#define FF_FS_TIMEOUT	1000
+
+/*--- End of configuration options ---*/
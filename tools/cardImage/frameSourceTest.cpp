@@ -0,0 +1,90 @@
+// Checks the player's frame sources that build on the host against a file, or a buffer, of known bytes.
+//
+//   frameSourceTest scratch-dir
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "hostFileSource.h"
+
+#define FILE_LENGTH 5000
+
+static unsigned char expected(uint32_t ofs) {
+    return (unsigned char)(ofs * 7 + ofs / 251);
+}
+
+static void testHostFileSource(const std::string& dir) {
+    std::string path = dir + "/hostFileSource.bin";
+    FILE* file = fopen(path.c_str(), "wb");
+    for (uint32_t i = 0; FILE_LENGTH > i; i++) {
+        fputc(expected(i), file);
+    }
+    fclose(file);
+
+    HostFileSource source;
+    CHECK(!source.open((dir + "/missing.bin").c_str()));
+    CHECK(source.open(path.c_str()));
+
+    unsigned char bytes[600];
+    for (uint32_t ofs : {0u, 1u, 511u, 512u, 1234u}) {
+        CHECK(sizeof(bytes) == source.read(bytes, ofs, sizeof(bytes)));
+        bool same = true;
+        for (uint32_t i = 0; sizeof(bytes) > i; i++) {
+            same = same && bytes[i] == expected(ofs + i);
+        }
+        CHECK(same);
+    }
+    CHECK(100 == source.read(bytes, FILE_LENGTH - 100, sizeof(bytes))); // cut short at the end
+
+    // fetch keeps the offset's place in the sector, with a sector of slack either side
+    static unsigned char buf[3 * SECTOR_SIZE + 1024];
+    for (uint32_t ofs : {0u, 7u, 513u, 4000u}) {
+        unsigned char* frame = source.fetch(buf, ofs, 900, NULL);
+        CHECK(buf + ofs % SECTOR_SIZE == frame);
+        bool same = frame != NULL;
+        for (uint32_t i = 0; same && 900 > i; i++) {
+            same = frame[i] == expected(ofs + i);
+        }
+        CHECK(same);
+    }
+    CHECK(NULL == source.fetch(buf, FILE_LENGTH - 100, 900, NULL)); // a frame that isn't all there fails
+
+    source.close();
+    CHECK(source.open(path.c_str())); // and opens again after closing
+    source.close();
+}
+
+static void testRamSource() {
+    std::vector<unsigned char> video(FILE_LENGTH);
+    for (uint32_t i = 0; FILE_LENGTH > i; i++) {
+        video[i] = expected(i);
+    }
+    RamSource source(video.data(), FILE_LENGTH);
+    CHECK(source.open(NULL));
+    CHECK(source.capabilities() & FrameSource::SEEK_FREE);
+
+    unsigned char bytes[600];
+    CHECK(sizeof(bytes) == source.read(bytes, 1234, sizeof(bytes)));
+    CHECK(0 == memcmp(bytes, video.data() + 1234, sizeof(bytes)));
+    CHECK(100 == source.read(bytes, FILE_LENGTH - 100, sizeof(bytes))); // cut short at the end
+    CHECK(0 == source.read(bytes, FILE_LENGTH + 10, sizeof(bytes)));
+
+    static unsigned char buf[3 * SECTOR_SIZE + 1024];
+    for (uint32_t ofs : {0u, 7u, 513u, 4000u}) {
+        unsigned char* frame = source.fetch(buf, ofs, 900, NULL);
+        CHECK(buf + ofs % SECTOR_SIZE == frame);
+        CHECK(frame && 0 == memcmp(frame, video.data() + ofs, 900));
+    }
+    CHECK(NULL == source.fetch(buf, FILE_LENGTH - 100, 900, NULL)); // a frame that isn't all there fails
+    CHECK(NULL == source.fetch(buf, FILE_LENGTH + 10, 900, NULL)); // and one past the end
+}
+
+int main(int argc, char** argv) {
+    std::string dir = argc > 1 ? argv[1] : ".";
+    testHostFileSource(dir);
+    testRamSource();
+    return checkResult("frameSourceTest");
+}
@@ -0,0 +1,16 @@
+// Stand-in for the Pico SDK's hardware/clocks.h in the host checks, with clk_peri at the player's 125MHz.
+#ifndef HOST_HARDWARE_CLOCKS_INCLUDED
+#define HOST_HARDWARE_CLOCKS_INCLUDED
+
+#include <stdint.h>
+
+enum clock_index {
+    clk_sys = 5,
+    clk_peri = 6,
+};
+
+static inline uint32_t clock_get_hz(enum clock_index clock) {
+    return 125 * 1000 * 1000;
+}
+
+#endif // HOST_HARDWARE_CLOCKS_INCLUDED
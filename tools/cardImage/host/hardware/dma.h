@@ -0,0 +1,12 @@
+// Stand-in for the Pico SDK's hardware/dma.h in the host checks. The emulated SPI (emulatedSpi.c) has
+// no DMA, transfers are done by the time they're started.
+#ifndef HOST_HARDWARE_DMA_INCLUDED
+#define HOST_HARDWARE_DMA_INCLUDED
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t ctrl;
+} dma_channel_config;
+
+#endif // HOST_HARDWARE_DMA_INCLUDED
@@ -0,0 +1,42 @@
+// Stand-in for the Pico SDK's hardware/gpio.h in the host checks. Pins are only levels, and a card's
+// chip select reaches the card (emulatedSpi.c).
+#ifndef HOST_HARDWARE_GPIO_INCLUDED
+#define HOST_HARDWARE_GPIO_INCLUDED
+
+#include <stdbool.h>
+
+#include "pico/types.h"
+
+#define GPIO_IN 0
+#define GPIO_OUT 1
+
+enum gpio_function {
+    GPIO_FUNC_SPI = 1,
+    GPIO_FUNC_SIO = 5,
+};
+
+enum gpio_drive_strength {
+    GPIO_DRIVE_STRENGTH_2MA = 0,
+    GPIO_DRIVE_STRENGTH_4MA = 1,
+    GPIO_DRIVE_STRENGTH_8MA = 2,
+    GPIO_DRIVE_STRENGTH_12MA = 3
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline void gpio_init(uint gpio) {}
+static inline void gpio_set_dir(uint gpio, bool out) {}
+static inline void gpio_pull_up(uint gpio) {}
+static inline void gpio_set_function(uint gpio, enum gpio_function fn) {}
+static inline void gpio_set_drive_strength(uint gpio, enum gpio_drive_strength drive) {}
+
+#endif // HOST_HARDWARE_GPIO_INCLUDED
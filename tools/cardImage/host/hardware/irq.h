@@ -0,0 +1,7 @@
+// Stand-in for the Pico SDK's hardware/irq.h in the host checks.
+#ifndef HOST_HARDWARE_IRQ_INCLUDED
+#define HOST_HARDWARE_IRQ_INCLUDED
+
+typedef void (*irq_handler_t)(void);
+
+#endif // HOST_HARDWARE_IRQ_INCLUDED
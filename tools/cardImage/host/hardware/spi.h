@@ -0,0 +1,31 @@
+// Stand-in for the Pico SDK's hardware/spi.h in the host checks, the SPIs being the emulated ones in
+// emulatedSpi.c.
+#ifndef HOST_HARDWARE_SPI_INCLUDED
+#define HOST_HARDWARE_SPI_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/types.h"
+
+typedef struct spi_inst {
+    uint baudrate; // what SCK actually is
+} spi_inst_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern spi_inst_t emulatedSpis[2];
+#define spi0 (&emulatedSpis[0])
+#define spi1 (&emulatedSpis[1])
+
+// Like the SDK's: the nearest rate at or under baudrate the PL022's dividers make from clk_peri.
+uint spi_set_baudrate(spi_inst_t* spi, uint baudrate);
+int spi_write_blocking(spi_inst_t* spi, const uint8_t* src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_HARDWARE_SPI_INCLUDED
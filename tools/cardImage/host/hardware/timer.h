@@ -0,0 +1,2 @@
+// Stand-in for the Pico SDK's hardware/timer.h in the host checks.
+#include "pico/time.h"
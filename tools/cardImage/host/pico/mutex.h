@@ -0,0 +1,26 @@
+// Stand-in for the Pico SDK's pico/mutex.h in the host checks, where there is only the one core.
+#ifndef HOST_PICO_MUTEX_INCLUDED
+#define HOST_PICO_MUTEX_INCLUDED
+
+#include <stdbool.h>
+
+#include "pico/time.h"
+
+typedef struct {
+    bool initialized;
+} mutex_t;
+
+#define auto_init_mutex(name) static mutex_t name = {true}
+
+static inline void mutex_init(mutex_t* mutex) {
+    mutex->initialized = true;
+}
+
+static inline bool mutex_is_initialized(mutex_t* mutex) {
+    return mutex->initialized;
+}
+
+static inline void mutex_enter_blocking(mutex_t* mutex) {}
+static inline void mutex_exit(mutex_t* mutex) {}
+
+#endif // HOST_PICO_MUTEX_INCLUDED
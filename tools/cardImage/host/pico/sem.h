@@ -0,0 +1,9 @@
+// Stand-in for the Pico SDK's pico/sem.h in the host checks.
+#ifndef HOST_PICO_SEM_INCLUDED
+#define HOST_PICO_SEM_INCLUDED
+
+typedef struct {
+    int permits;
+} semaphore_t;
+
+#endif // HOST_PICO_SEM_INCLUDED
@@ -0,0 +1,13 @@
+// Stand-in for the Pico SDK's pico/stdlib.h in the host checks, with the time read off the card
+// emulator's clock (emulatedCard.c).
+#ifndef HOST_PICO_STDLIB_INCLUDED
+#define HOST_PICO_STDLIB_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pico/time.h"
+
+#define panic(...) (fprintf(stderr, __VA_ARGS__), abort())
+
+#endif // HOST_PICO_STDLIB_INCLUDED
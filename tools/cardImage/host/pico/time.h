@@ -0,0 +1,49 @@
+// Stand-in for the Pico SDK's pico/time.h in the host checks, on the card emulator's clock.
+#ifndef HOST_PICO_TIME_INCLUDED
+#define HOST_PICO_TIME_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/types.h"
+#include "cardImage.h"
+
+#define nil_time ((absolute_time_t)0)
+
+static inline uint32_t time_us_32() {
+    return (uint32_t)emulatedCardNow();
+}
+
+static inline uint64_t time_us_64() {
+    return emulatedCardNow();
+}
+
+static inline absolute_time_t get_absolute_time() {
+    return emulatedCardNow() + 1; // never nil_time
+}
+
+static inline bool is_nil_time(absolute_time_t t) {
+    return nil_time == t;
+}
+
+static inline absolute_time_t make_timeout_time_us(uint64_t us) {
+    return get_absolute_time() + us;
+}
+
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return make_timeout_time_us((uint64_t)ms * 1000);
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+static inline bool time_reached(absolute_time_t t) {
+    return get_absolute_time() >= t;
+}
+
+static inline void busy_wait_us(uint64_t us) {
+    emulatedCardWait((uint32_t)us);
+}
+
+#endif // HOST_PICO_TIME_INCLUDED
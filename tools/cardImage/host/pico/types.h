@@ -0,0 +1,15 @@
+// Stand-in for the Pico SDK's pico/types.h in the host checks.
+#ifndef HOST_PICO_TYPES_INCLUDED
+#define HOST_PICO_TYPES_INCLUDED
+
+#include <stdint.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define __not_in_flash_func(name) name
+
+// from pico/platform.h, which every SDK header brings in
+static inline void tight_loop_contents(void) {}
+
+#endif // HOST_PICO_TYPES_INCLUDED
@@ -0,0 +1,226 @@
+// Builds a FAT32 or exFAT card image for the player, with every video (.crv, .cri) in one run of
+// sectors starting on an allocation unit boundary and .crv frames moved onto sector boundaries.
+// Write it to the card with dd or any raw image writer.
+//
+//   cardImage [-exfat] [-size MB] [-au KB] card.img video.crv [playlist.txt other.crv ...]
+//
+// -au should be the card's allocation unit, which the player's SD driver reads from the card
+// (au_sectors in sd_card_t). 4MB, the default, is what most SDHC cards have.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ff.h"
+#include "cardImage.h"
+
+#define SECTOR_SIZE 512
+#define MIN_IMAGE_SIZE (64ull * 1024 * 1024) // small enough FAT32 volumes are refused by f_mkfs
+
+typedef struct {
+    const char* path;
+    const char* name; // in the root of the card
+    unsigned char* data;
+    size_t length;
+    int placed; // laid out from an allocation unit boundary in one run
+} InputFile;
+
+static void fail(const char* what, const char* name, FRESULT res) {
+    fprintf(stderr, "%s %s failed (FatFs error %d)\n", what, name, res);
+    exit(1);
+}
+
+static unsigned char* loadFile(const char* path, size_t* length) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    fseeko(f, 0, SEEK_END);
+    *length = ftello(f);
+    fseeko(f, 0, SEEK_SET);
+    unsigned char* data = malloc(*length ? *length : 1);
+    if (!data || *length != fread(data, 1, *length, f)) {
+        fprintf(stderr, "Can't read %s\n", path);
+        exit(1);
+    }
+    fclose(f);
+    return data;
+}
+
+// Allocates the file's clusters in one run starting on the first allocation unit boundary with
+// room for it.
+static void placeFile(FATFS* fs, FIL* fil, InputFile* in, DWORD au) {
+    DWORD auClusters = au > fs->csize ? au / fs->csize : 1;
+    for (DWORD clst = 2; fs->n_fatent > clst; clst += auClusters) {
+        // a dry run first: f_expand takes the first free run from where it's told to look
+        fs->last_clst = clst;
+        if (FR_OK == f_expand(fil, in->length, 0) && clst - 1 == fs->last_clst) {
+            fs->last_clst = clst;
+            FRESULT res = f_expand(fil, in->length, 1);
+            if (FR_OK != res) {
+                fail("Allocating", in->name, res);
+            }
+            return;
+        }
+    }
+    fprintf(stderr, "No free allocation unit run big enough for %s, make the image bigger\n", in->name);
+    exit(1);
+}
+
+// Checks the file really did end up as one run, and where.
+static void reportFile(FATFS* fs, InputFile* in, DWORD au) {
+    FIL fil;
+    DWORD linkMap[8];
+    FRESULT res = f_open(&fil, in->name, FA_READ);
+    if (FR_OK != res) {
+        fail("Reopening", in->name, res);
+    }
+    fil.cltbl = linkMap;
+    linkMap[0] = sizeof(linkMap) / sizeof(linkMap[0]);
+    res = f_lseek(&fil, CREATE_LINKMAP);
+    if ((FR_OK != res && FR_NOT_ENOUGH_CORE != res) || 4 != linkMap[0]) {
+        fprintf(stderr, "%s didn't end up contiguous\n", in->name);
+        exit(1);
+    }
+    LBA_t sector = fs->database + (LBA_t)fs->csize * (linkMap[2] - 2);
+    printf("%-16s %10zu bytes at sector %llu, allocation unit %llu%s\n", in->name, in->length, (unsigned long long)sector,
+           (unsigned long long)(sector / au), sector % au ? " (not on its boundary)" : "");
+    f_close(&fil);
+}
+
+// the player's FatFs (FatFs_SPI_player) only knows 8.3 names
+static int isShortName(const char* name) {
+    const char* dot = strchr(name, '.');
+    size_t base = dot ? (size_t)(dot - name) : strlen(name);
+    return base > 0 && base <= 8 && (!dot || (!strchr(dot + 1, '.') && strlen(dot + 1) <= 3));
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: cardImage [-exfat] [-size MB] [-au KB] card.img file...\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    int exfat = 0;
+    unsigned long long size = 0;
+    DWORD au = 4096 * 1024 / SECTOR_SIZE;
+    int arg = 1;
+    for (; argc > arg && '-' == argv[arg][0]; arg++) {
+        if (0 == strcmp(argv[arg], "-exfat")) {
+            exfat = 1;
+        } else if (0 == strcmp(argv[arg], "-size") && argc > arg + 1) {
+            size = strtoull(argv[++arg], NULL, 10) * 1024 * 1024;
+        } else if (0 == strcmp(argv[arg], "-au") && argc > arg + 1) {
+            au = strtoul(argv[++arg], NULL, 10) * 1024 / SECTOR_SIZE;
+        } else {
+            usage();
+        }
+    }
+    if (argc - arg < 2) {
+        usage();
+    }
+    if (0 == au || au > 32768 || (au & (au - 1))) {
+        fprintf(stderr, "The allocation unit has to be a power of 2 from 1KB to 16MB\n");
+        return 2;
+    }
+    const char* imagePath = argv[arg++];
+    if (exfat) {
+        printf("exFAT: the player only reads it when built with FatFs_SPI rather than FatFs_SPI_player\n");
+    }
+
+    // reading everything in first to size the image
+    int numFiles = argc - arg;
+    InputFile* files = calloc(numFiles, sizeof(InputFile));
+    unsigned long long needed = 0;
+    for (int i = 0; numFiles > i; i++) {
+        InputFile* in = &files[i];
+        in->path = argv[arg + i];
+        const char* slash = strrchr(in->path, '/');
+        in->name = slash ? slash + 1 : in->path;
+        if (!isShortName(in->name)) {
+            printf("%s: not an 8.3 name, the player won't find it unless built with FatFs_SPI\n", in->name);
+        }
+        in->data = loadFile(in->path, &in->length);
+        if (in->length >= 3 && 0 == memcmp(in->data, "CRV", 3)) {
+            const char* why;
+            size_t alignedLength;
+            unsigned char* aligned = alignVideo(in->data, in->length, &alignedLength, &why);
+            if (aligned) {
+                free(in->data);
+                in->data = aligned;
+                in->length = alignedLength;
+            } else {
+                printf("%s: %s, copying it as it is\n", in->name, why);
+            }
+        }
+        in->placed = in->length > 0 && in->length >= 3 && (0 == memcmp(in->data, "CRV", 3) || 0 == memcmp(in->data, "CRI", 3));
+        needed += (in->length + (unsigned long long)au * SECTOR_SIZE - 1) / ((unsigned long long)au * SECTOR_SIZE) * au * SECTOR_SIZE;
+    }
+    if (0 == size) {
+        size = needed + 16ull * au * SECTOR_SIZE; // room for the filesystem and a spare unit or two
+        if (size < MIN_IMAGE_SIZE) {
+            size = MIN_IMAGE_SIZE;
+        }
+    }
+    size = size / ((unsigned long long)au * SECTOR_SIZE) * au * SECTOR_SIZE;
+
+    FILE* image = fopen(imagePath, "wb+");
+    if (!image || 0 != ftruncate(fileno(image), size)) {
+        perror(imagePath);
+        return 1;
+    }
+    imageAttach(image, size / SECTOR_SIZE, au);
+
+    static BYTE work[FF_MAX_SS * 64];
+    MKFS_PARM format = {(BYTE)(exfat ? FM_EXFAT : FM_FAT32), 0, au, 0, 0};
+    FRESULT res = f_mkfs("", &format, work, sizeof(work));
+    if (FR_OK != res) {
+        fail("Formatting", imagePath, res);
+    }
+    static FATFS fs;
+    res = f_mount(&fs, "", 1);
+    if (FR_OK != res) {
+        fail("Mounting", imagePath, res);
+    }
+    if (fs.database % au) {
+        fprintf(stderr, "Data area isn't on an allocation unit boundary\n");
+        return 1;
+    }
+
+    for (int i = 0; numFiles > i; i++) {
+        InputFile* in = &files[i];
+        FIL fil;
+        res = f_open(&fil, in->name, FA_CREATE_NEW | FA_WRITE);
+        if (FR_OK != res) {
+            fail("Creating", in->name, res);
+        }
+        if (in->placed) {
+            placeFile(&fs, &fil, in, au);
+        }
+        UINT written;
+        res = f_write(&fil, in->data, in->length, &written);
+        if (FR_OK != res || written != in->length) {
+            fail("Writing", in->name, res);
+        }
+        res = f_close(&fil);
+        if (FR_OK != res) {
+            fail("Closing", in->name, res);
+        }
+    }
+
+    printf("%s: %s, %lluMB, %lu sector clusters, %lu sector allocation units\n", imagePath, exfat ? "exFAT" : "FAT32",
+           size / 1024 / 1024, (unsigned long)fs.csize, (unsigned long)au);
+    for (int i = 0; numFiles > i; i++) {
+        if (files[i].placed) {
+            reportFile(&fs, &files[i], au);
+        } else {
+            printf("%-16s %10zu bytes\n", files[i].name, files[i].length);
+        }
+    }
+
+    f_mount(NULL, "", 0);
+    fclose(image);
+    return 0;
+}
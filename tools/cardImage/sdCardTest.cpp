@@ -0,0 +1,100 @@
+// Runs the player's SD driver (FatFs_SPI's sd_card.c and sd_spi.c) on an emulated card over an emulated
+// SPI: bring-up, CMD6 high speed, and the baud rate ramp stopping where the card stops reading cleanly.
+//
+//   sdCardTest scratch-dir
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "cardImage.h"
+#include "check.h"
+#include "diskio.h"
+#include "hw_config.h"
+#include "sd_card.h"
+
+#define CARD_SECTORS 2048
+#define AU_SECTORS 8192
+#define CS_PIN 13
+
+// wired up as hardware.cpp does it, SCK asked for at 25MHz
+static spi_t spi;
+static sd_card_t card;
+
+extern "C" {
+size_t sd_get_num() { return 1; }
+sd_card_t* sd_get_by_num(size_t num) { return 0 == num ? &card : NULL; }
+size_t spi_get_num() { return 1; }
+spi_t* spi_get_by_num(size_t num) { return 0 == num ? &spi : NULL; }
+}
+
+static unsigned char expected(uint32_t ofs) {
+    return (unsigned char)(ofs * 7 + ofs / 251);
+}
+
+// Brings the card up on the emulated card with the given timing, as if it had just gone in.
+static bool bringUp(FILE* image, const EmulatedTiming& timing) {
+    emulatedCardAttachDrive(0, image, CARD_SECTORS, AU_SECTORS, &timing);
+    emulatedSpiWire(0, spi.hw_inst, CS_PIN);
+    card.m_Status = STA_NOINIT;
+    return 0 == (card.init(&card) & STA_NOINIT);
+}
+
+static bool readsBack(uint32_t sector, uint32_t count) {
+    static uint8_t buffer[8 * 512];
+    if (0 != card.read_blocks(&card, buffer, sector, count)) {
+        return false;
+    }
+    for (uint32_t i = 0; count * 512 > i; i++) {
+        if (buffer[i] != expected(sector * 512 + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testCard(FILE* image, const char* what, bool highSpeed, uint32_t maxClockHz, bool expectHighSpeed,
+                     uint expectedHz) {
+    EmulatedTiming timing = {25 * 1000 * 1000, 300, 20, 1000, 0, 0, highSpeed, maxClockHz};
+    printf("sdCardTest: %s\n", what);
+    CHECK(bringUp(image, timing));
+    CHECK(CARD_SECTORS == card.sectors);
+    CHECK(AU_SECTORS == card.au_sectors);
+    CHECK(expectHighSpeed == card.high_speed);
+    CHECK(expectHighSpeed == emulatedCardHighSpeed(0));
+    printf("sdCardTest: settled on %u Hz\n", card.baud_rate);
+    CHECK(expectedHz == card.baud_rate);
+    CHECK(expectedHz == spi.hw_inst->baudrate);
+    CHECK(readsBack(0, 1));
+    CHECK(readsBack(3, 8)); // CMD18 and CMD12 at the settled rate
+}
+
+int main(int argc, char** argv) {
+    std::string dir = argc > 1 ? argv[1] : ".";
+    std::string path = dir + "/sdCard.img";
+    FILE* image = fopen(path.c_str(), "w+b");
+    if (!image) {
+        fprintf(stderr, "sdCardTest: can't write %s\n", path.c_str());
+        return 1;
+    }
+    for (uint32_t i = 0; CARD_SECTORS * 512 > i; i++) {
+        fputc(expected(i), image);
+    }
+    fflush(image);
+
+    spi.hw_inst = spi1;
+    spi.baud_rate = 25 * 1000 * 1000;
+    card.pcName = "0:";
+    card.spi = &spi;
+    card.ss_gpio = CS_PIN;
+    CHECK(sd_init_driver());
+
+    // clk_peri is 125MHz, so SCK steps 20.8, 31.25, 62.5MHz from the 25MHz asked for
+    testCard(image, "high speed card good to 40MHz", true, 40 * 1000 * 1000, true, 125000000 / 4);
+    testCard(image, "high speed card good to 30MHz", true, 30 * 1000 * 1000, true, 125000000 / 6);
+    testCard(image, "default speed card good to 40MHz", false, 40 * 1000 * 1000, false, 125000000 / 6);
+    testCard(image, "high speed card good to anything", true, 0, true, 125000000 / 4); // the 50MHz cap
+
+    fclose(image);
+    return checkResult("sdCardTest");
+}
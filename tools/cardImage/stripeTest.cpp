@@ -0,0 +1,176 @@
+// Checks striped playback (StripedSource) on two emulated cards: the stripes come back in order, LZ
+// frames decompress as they land, both cards read at once, and a read that can't make its deadline
+// gives up.
+//
+//   stripeTest scratch-dir
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "frameSource.h"
+#include "cardImage.h"
+#include "check.h"
+
+#define STRIPE_SECTORS 8
+#define VIDEO_SECTORS 256
+#define VIDEO_LENGTH (VIDEO_SECTORS * SECTOR_SIZE)
+#define AU_SECTORS 8192
+
+static const EmulatedTiming timing = {25 * 1000 * 1000, 300, 20, 1000, 0, 0}; // cardBench's middling card
+
+static std::vector<unsigned char> video(VIDEO_LENGTH);
+static FILE* images[3]; // the two halves of the stripes, and the whole video on one card
+
+static unsigned char expected(uint32_t ofs) {
+    return (unsigned char)(ofs * 7 + ofs / 251);
+}
+
+// An LZ4 block of many sequences, so it spans several sectors, and what it decompresses to.
+static void makeLzBlock(std::vector<unsigned char>& block, std::vector<unsigned char>& decoded) {
+    uint32_t seed = 1;
+    for (int sequence = 0; 140 > sequence; sequence++) {
+        block.push_back(0xff); // 15 + 25 literals, 15 + 4 + 41 long match
+        block.push_back(25);
+        for (int i = 0; 40 > i; i++) {
+            seed = seed * 1103515245 + 12345;
+            block.push_back(seed >> 16);
+            decoded.push_back(seed >> 16);
+        }
+        uint32_t offset = 40 + sequence % 3 * 20;
+        offset = offset > decoded.size() ? decoded.size() : offset;
+        block.push_back(offset & 0xff);
+        block.push_back(offset >> 8);
+        block.push_back(41);
+        for (int i = 0; 60 > i; i++) {
+            decoded.push_back(decoded[decoded.size() - offset]);
+        }
+    }
+    block.push_back(0x50); // the last 5 bytes are literals
+    for (int i = 0; 5 > i; i++) {
+        block.push_back(i);
+        decoded.push_back(i);
+    }
+}
+
+static FILE* writeImage(const std::string& path, const std::vector<unsigned char>& bytes) {
+    FILE* file = fopen(path.c_str(), "w+b");
+    if (file) {
+        fwrite(bytes.data(), 1, bytes.size(), file);
+        fflush(file);
+    }
+    return file;
+}
+
+static bool makeImages(const std::string& dir) {
+    std::vector<unsigned char> halves[2];
+    for (uint32_t sector = 0; VIDEO_SECTORS > sector; sector++) {
+        std::vector<unsigned char>& half = halves[sector / STRIPE_SECTORS % 2];
+        half.insert(half.end(), video.begin() + sector * SECTOR_SIZE, video.begin() + (sector + 1) * SECTOR_SIZE);
+    }
+    images[0] = writeImage(dir + "/stripe0.img", halves[0]);
+    images[1] = writeImage(dir + "/stripe1.img", halves[1]);
+    images[2] = writeImage(dir + "/whole.img", video);
+    return images[0] && images[1] && images[2];
+}
+
+static void attachStripes() {
+    emulatedCardAttachDrive(0, images[0], VIDEO_SECTORS / 2, AU_SECTORS, &timing);
+    emulatedCardAttachDrive(1, images[1], VIDEO_SECTORS / 2, AU_SECTORS, &timing);
+}
+
+static bool matches(const unsigned char* bytes, uint32_t ofs, uint32_t len) {
+    return bytes && 0 == memcmp(bytes, video.data() + ofs, len);
+}
+
+static void testStripes() {
+    attachStripes();
+    StripedSource source(0, 1, STRIPE_SECTORS);
+    CHECK(source.open(NULL));
+
+    unsigned char bytes[3000];
+    for (uint32_t ofs : {0u, 100u, 4095u, 4096u, 9000u, VIDEO_LENGTH - 3000u}) {
+        CHECK(sizeof(bytes) == source.read(bytes, ofs, sizeof(bytes)));
+        CHECK(matches(bytes, ofs, sizeof(bytes)));
+    }
+
+    // spans starting in either card's stripe, inside one stripe, and across many
+    static unsigned char buf[VIDEO_LENGTH + 2 * SECTOR_SIZE];
+    struct { uint32_t ofs, len; } spans[] = {{0, 100}, {10, 4086}, {4096, 4096}, {5000, 20000}, {511, 2}, {33000, 60000}};
+    for (auto span : spans) {
+        unsigned char* frame = source.fetch(buf, span.ofs, span.len, NULL);
+        CHECK(buf + span.ofs % SECTOR_SIZE == frame);
+        CHECK(matches(frame, span.ofs, span.len));
+    }
+    CHECK(2 == emulatedCardsMostBusy());
+}
+
+static void testLz(const std::vector<unsigned char>& block, const std::vector<unsigned char>& decoded, uint32_t ofs) {
+    attachStripes();
+    StripedSource source(0, 1, STRIPE_SECTORS);
+    CHECK(source.open(NULL));
+
+    static unsigned char buf[VIDEO_LENGTH + 2 * SECTOR_SIZE];
+    std::vector<unsigned char> out(decoded.size());
+    LzDecoder lz;
+    lzBegin(&lz, buf + ofs % SECTOR_SIZE, block.size(), out.data(), out.size());
+    CHECK(source.fetch(buf, ofs, block.size(), &lz));
+    CHECK(lz.in > lz.inStart); // some of it was done while the rest was still coming
+    CHECK(1 == lzDecode(&lz, lz.inEnd));
+    CHECK(out == decoded);
+}
+
+// Both cards at once should take not much more than half as long as one card reading the lot.
+static void testTiming() {
+    const uint32_t ofs = 2 * SECTOR_SIZE, len = 64 * 1024;
+    static unsigned char buf[VIDEO_LENGTH + 2 * SECTOR_SIZE];
+
+    attachStripes();
+    StripedSource striped(0, 1, STRIPE_SECTORS);
+    CHECK(striped.open(NULL));
+    uint64_t start = emulatedCardNow();
+    CHECK(matches(striped.fetch(buf, ofs, len, NULL), ofs, len));
+    uint64_t stripedUs = emulatedCardNow() - start;
+
+    emulatedCardAttachDrive(0, images[2], VIDEO_SECTORS, AU_SECTORS, &timing);
+    RawSectorSource raw(0, 0);
+    CHECK(raw.open(NULL));
+    start = emulatedCardNow();
+    CHECK(matches(raw.fetch(buf, ofs, len, NULL), ofs, len));
+    uint64_t rawUs = emulatedCardNow() - start;
+
+    printf("stripeTest: %u bytes in %llu us on two cards, %llu us on one\n", len, (unsigned long long)stripedUs,
+           (unsigned long long)rawUs);
+    CHECK(stripedUs * 10 < rawUs * 7);
+
+    // and a frame that can't be in by its deadline is dropped rather than waited for
+    attachStripes();
+    striped.setDeadline((uint32_t)emulatedCardNow() + 500);
+    CHECK(NULL == striped.fetch(buf, ofs, len, NULL));
+    striped.setDeadline(0);
+}
+
+int main(int argc, char** argv) {
+    std::string dir = argc > 1 ? argv[1] : ".";
+
+    std::vector<unsigned char> block, decoded;
+    makeLzBlock(block, decoded);
+    const uint32_t lzOfs = 3 * STRIPE_SECTORS * SECTOR_SIZE - 700; // near the end of a stripe, on over the next two
+    for (uint32_t i = 0; VIDEO_LENGTH > i; i++) {
+        video[i] = expected(i);
+    }
+    memcpy(video.data() + lzOfs, block.data(), block.size());
+    if (!makeImages(dir)) {
+        fprintf(stderr, "stripeTest: can't write the card images in %s\n", dir.c_str());
+        return 1;
+    }
+
+    testStripes();
+    testLz(block, decoded, lzOfs);
+    testTiming();
+    for (FILE* image : images) {
+        fclose(image);
+    }
+    return checkResult("stripeTest");
+}
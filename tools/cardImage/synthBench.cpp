@@ -0,0 +1,163 @@
+// Times the player's scene synthesis (frameSynthesis.cpp) on the build machine, for main.cpp's clock, a
+// full screen image and a scene with as many elements as a scene can hold, against the time a scene frame
+// is on show. The build machine is a lot quicker than the RP2040, so the times are for comparing scenes
+// and synthesis changes with each other (build with -DCMAKE_BUILD_TYPE=Release for numbers worth
+// comparing); synthTime and maxSynthTime are the numbers on the player.
+//
+//   synthBench [frames]
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "frameSynthesis.h"
+#include "playerConfig.h"
+
+#define DEFAULT_FRAMES 200
+#define IMAGE_SIZE 64
+
+static char clockText[6] = "12:34";
+static uint32_t image[IMAGE_SIZE * IMAGE_SIZE];
+static const uint32_t heart[8] = {0x00, 0x66, 0xff, 0xff, 0x7e, 0x3c, 0x18, 0x00};
+
+// main.cpp's clock: a ring, the time in the middle and a hand going round
+static void clockScene(Scene* scene) {
+    scene->background = SCENE_RGB(0, 0, 0);
+    scene->elementCount = 3;
+
+    SceneElement* ring = &scene->elements[0];
+    ring->kind = SCENE_ARC;
+    ring->color = SCENE_RGB(0, 0, 80);
+    ring->innerRadius = 60 * 16;
+    ring->outerRadius = 64 * 16;
+
+    SceneElement* text = &scene->elements[1];
+    text->kind = SCENE_TEXT;
+    text->color = SCENE_RGB(255, 255, 255);
+    text->text = clockText;
+    text->scale = 2 * 16;
+    text->x = -29 * 16;
+    text->y = 7 * 16;
+
+    SceneElement* hand = &scene->elements[2];
+    hand->kind = SCENE_ARC;
+    hand->color = SCENE_RGB(255, 40, 0);
+    hand->innerRadius = 40 * 16;
+    hand->outerRadius = 58 * 16;
+    hand->span = 0x400;
+}
+
+// a picture over the whole display, as the image reader plays
+static void imageScene(Scene* scene) {
+    scene->background = SCENE_RGB(0, 0, 0);
+    scene->elementCount = 1;
+
+    SceneElement* picture = &scene->elements[0];
+    picture->kind = SCENE_IMAGE;
+    picture->pixels = image;
+    picture->width = IMAGE_SIZE;
+    picture->height = IMAGE_SIZE;
+    picture->scale = 2048 / IMAGE_SIZE;
+    picture->x = -1024;
+    picture->y = 1024;
+}
+
+// every element a scene can have, of every kind, all over the display
+static void busyScene(Scene* scene) {
+    scene->background = SCENE_RGB(0, 0, 10);
+    scene->elementCount = SCENE_MAX_ELEMENTS;
+    for (int i = 0; SCENE_MAX_ELEMENTS > i; i++) {
+        SceneElement* e = &scene->elements[i];
+        e->color = SCENE_RGB(40 * i % 256, 255 - 16 * i, 90);
+        switch (i % 4) {
+            case 0:
+                e->kind = SCENE_ARC;
+                e->innerRadius = 64 * i;
+                e->outerRadius = 64 * i + 48;
+                e->startAngle = 4096 * i;
+                e->span = 0x3000;
+                break;
+            case 1:
+                e->kind = SCENE_SPRITE;
+                e->bitmap = heart;
+                e->width = 8;
+                e->height = 8;
+                e->scale = 3 * 16;
+                e->x = (i - 8) * 100;
+                e->y = 600 - 70 * i;
+                break;
+            case 2:
+                e->kind = SCENE_TEXT;
+                e->text = clockText;
+                e->scale = 16;
+                e->x = -300 + 30 * i;
+                e->y = 800 - 100 * i;
+                break;
+            default:
+                e->kind = SCENE_IMAGE;
+                e->pixels = image;
+                e->width = IMAGE_SIZE;
+                e->height = IMAGE_SIZE;
+                e->scale = 4;
+                e->x = (i - 8) * 90;
+                e->y = -200 + 40 * i;
+                break;
+        }
+    }
+}
+
+// Returns false if a frame came out with no bursts or more than its buffer holds.
+static bool bench(const char* name, void (*setup)(Scene*), int frames) {
+    static Scene scene;
+    scene = Scene();
+    setup(&scene);
+
+    std::vector<unsigned char> out(synthFrameLength());
+    unsigned char* groups[4];
+    uint32_t bursts[4], slots[4];
+    uint64_t totalUs = 0, maxUs = 0, totalBursts = 0;
+    bool ok = true;
+    for (int frame = 0; frames > frame; frame++) {
+        if (3 <= scene.elementCount && SCENE_ARC == scene.elements[2].kind) {
+            scene.elements[2].startAngle += 0x111; // keep things moving
+        }
+        auto start = std::chrono::steady_clock::now();
+        synthesizeFrame(&scene, 0 == frame % 2, out.data(), groups, bursts, slots);
+        uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        totalUs += us;
+        maxUs = us > maxUs ? us : maxUs;
+
+        uint32_t frameBursts = bursts[0] + bursts[1] + bursts[2] + bursts[3];
+        totalBursts += frameBursts;
+        ok = ok && 0 < frameBursts && out.size() >= (size_t)(groups[3] - groups[0]) + 8 * bursts[3];
+    }
+    printf("%-8s %3d elements: %6llu us a frame on average, %6llu max, %5llu bursts, %.1f%% of the %u us "
+           "a frame is on show\n",
+           name, scene.elementCount, (unsigned long long)(totalUs / frames), (unsigned long long)maxUs,
+           (unsigned long long)(totalBursts / frames), 100.0 * totalUs / frames / SCENE_FRAME_TIME_US,
+           SCENE_FRAME_TIME_US);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int frames = 1 < argc ? atoi(argv[1]) : DEFAULT_FRAMES;
+    if (0 >= frames) {
+        fprintf(stderr, "usage: synthBench [frames]\n");
+        return 2;
+    }
+    for (int y = 0; IMAGE_SIZE > y; y++) {
+        for (int x = 0; IMAGE_SIZE > x; x++) {
+            image[y * IMAGE_SIZE + x] = SCENE_RGB(4 * x, 4 * y, (x ^ y) * 4);
+        }
+    }
+
+    bool ok = bench("clock", clockScene, frames);
+    ok = bench("image", imageScene, frames) && ok;
+    ok = bench("busy", busyScene, frames) && ok;
+    if (!ok) {
+        fprintf(stderr, "synthBench: a frame came out empty or overran its buffer\n");
+        return 1;
+    }
+    return 0;
+}
@@ -34,6 +34,9 @@ func main() {
 	fmt.Println("Time to encode frames: ", time.Since(tStart))
 
 	povencoder.SaveEncodedVideo(encodedFrames, "outputFile.crv")
+	//povencoder.SaveFlashImage("outputFile.crv", "outputFile.uf2") // for flash playback
+	//povencoder.SaveStripedImages("outputFile.crv", "card0.img", "card1.img") // for striped playback
+	//povencoder.SaveImageStream(frames, "outputFile.cri", 96) // for the player to resample itself
 
 	//povencoder.RenderFrames(encodedFrames, 1280)
 }
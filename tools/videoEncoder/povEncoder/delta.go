@@ -0,0 +1,68 @@
+package povencoder
+
+import "encoding/binary"
+
+// Delta frames rebuild each group from the same group two frames back, the last frame drawn with the
+// board the same way up. A group is a list of runs: a uint16 count of bursts to copy from the reference
+// at the same position, a uint16 count of bursts stored in the run, then those bursts (packed when the
+// file packs bursts). Runs go on until the end of the group.
+
+// A burst whose values are all within this of the reference is copied from it instead
+const deltaTolerance = 2
+
+// The first two frames of every keyFrameInterval never reference anything, so playback can start there
+const keyFrameInterval = 48
+
+// Stores frames as deltas against the frame two back when that is smaller
+var UseDelta = true
+
+func burstsClose(a, b []byte) bool {
+	if isHoldBurst(a) || isHoldBurst(b) {
+		return string(a) == string(b)
+	}
+
+	for k := 0; k < 8; k += 2 {
+		delta := int(a[k+1]) - int(b[k+1])
+		if a[k] != b[k] || delta > deltaTolerance || delta < -deltaTolerance {
+			return false
+		}
+	}
+
+	return true
+}
+
+// Returns the group's runs against ref, and the bursts the player will rebuild from them
+func deltaGroup(bursts, ref []byte) ([]byte, []byte) {
+	out := make([]byte, 0, len(bursts)/2)
+	expanded := make([]byte, 0, len(bursts))
+	matches := func(pos int) bool {
+		return pos*8+8 <= len(ref) && burstsClose(bursts[pos*8:pos*8+8], ref[pos*8:pos*8+8])
+	}
+
+	numBursts := len(bursts) / 8
+	for pos := 0; pos < numBursts; {
+		copies := 0
+		for pos+copies < numBursts && copies < 0xFFFF && matches(pos+copies) {
+			copies++
+		}
+		expanded = append(expanded, ref[pos*8:(pos+copies)*8]...)
+		pos += copies
+
+		literals := 0
+		for pos+literals < numBursts && literals < 0xFFFF && !matches(pos+literals) {
+			literals++
+		}
+		stored := bursts[pos*8 : (pos+literals)*8]
+		expanded = append(expanded, stored...)
+		pos += literals
+
+		out = binary.LittleEndian.AppendUint16(out, uint16(copies))
+		out = binary.LittleEndian.AppendUint16(out, uint16(literals))
+		if PackBursts {
+			stored, _ = packPairs(stored, 8, nil, nil)
+		}
+		out = append(out, stored...)
+	}
+
+	return out, expanded
+}
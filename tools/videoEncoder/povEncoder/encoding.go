@@ -14,6 +14,7 @@ import (
 
 type EncodedGroup struct {
 	Packets []byte
+	Slots   int // number of bursts the packets stand for, holds count for every slot they cover
 }
 
 // Represents an eighth arc. So four per frame
@@ -25,6 +26,7 @@ type EncodedFrame struct {
 	Segments    []EncodedSegment
 	timeOfFrame time.Duration
 	startAngle  float64
+	KeyFrame    bool // stored without reference to earlier frames
 }
 
 type ledColor struct {
@@ -40,6 +42,13 @@ const numLEDs = 128
 
 const numThreads = 12
 
+// A slot where no chip has a channel off by more than this is left alone rather than spending a burst on it
+const holdThreshold = 2
+
+// First byte of a hold burst. Real commands are always even so they can't be mistaken for it.
+const holdBurstMarker = 0x01
+const maxHoldSlots = 0xFFFF
+
 func EncodeFrame(img image.Image, timeOfFrame time.Duration, leftBottom bool) (*EncodedFrame, error) {
 	// if leftBottom is true, it means the side of the board that has the hall sensor is down.
 	// if leftBottom is false, it means the side of the board that has the hall sensor is up.
@@ -67,6 +76,7 @@ func EncodeFrame(img image.Image, timeOfFrame time.Duration, leftBottom bool) (*
 	}
 
 	credits := []float64{0, 0, 0, 0} // accumulation of allotments
+	holdSlots := []int{0, 0, 0, 0}   // slots skipped since the last burst, written out as one hold
 	ledColors := make([]ledColor, numLEDs)
 	ledLastUpdated := make([]float64, numLEDs)
 	for i := 0; i < numLEDs; i++ {
@@ -86,6 +96,7 @@ func EncodeFrame(img image.Image, timeOfFrame time.Duration, leftBottom bool) (*
 
 		if angle-workingSegmentStart > 3.14159/2 {
 			// segment is done
+			flushHolds(workingGroups, holdSlots)
 			doneSegments = append(doneSegments, EncodedSegment{Groups: workingGroups})
 			workingSegmentStart = angle
 			workingGroups = make([]EncodedGroup, len(groupPacketsPerSecond))
@@ -115,6 +126,9 @@ func EncodeFrame(img image.Image, timeOfFrame time.Duration, leftBottom bool) (*
 				// picking the most despirate channel from each chip
 				chipsPerGroup := len(newLEDColors) / ledsPerIC
 				packet := make([]byte, 0, 8)
+				worthSending := false
+				updatedLEDs := make([]int, 0, chipsPerGroup)
+				updatedChannels := make([]int, 0, chipsPerGroup)
 				for chipIdx := chipsPerGroup - 1; chipIdx >= 0; chipIdx-- {
 					// finding the most despirate channel
 					mostLEDIdx := 0
@@ -159,24 +173,41 @@ func EncodeFrame(img image.Image, timeOfFrame time.Duration, leftBottom bool) (*
 					// forming the command
 					cmd, value := formCommand(mostLEDIdx%8, mostChannel, newLEDColors[mostLEDIdx])
 					packet = append(packet, cmd, value)
+					updatedLEDs = append(updatedLEDs, mostLEDIdx)
+					updatedChannels = append(updatedChannels, mostChannel)
+					if maxDelta > holdThreshold {
+						worthSending = true
+					}
+				}
 
-					// updating the LED color
-					if mostChannel == 0 {
-						ledColors[mostLEDIdx+startLEDIdx].r = newLEDColors[mostLEDIdx].r
-					} else if mostChannel == 1 {
-						ledColors[mostLEDIdx+startLEDIdx].g = newLEDColors[mostLEDIdx].g
+				if !worthSending {
+					// nothing has drifted enough to be seen, hold the LEDs as they are instead
+					holdSlots[groupIdx]++
+					continue
+				}
+
+				// updating the LED colors
+				for k, ledIdx := range updatedLEDs {
+					if updatedChannels[k] == 0 {
+						ledColors[ledIdx+startLEDIdx].r = newLEDColors[ledIdx].r
+					} else if updatedChannels[k] == 1 {
+						ledColors[ledIdx+startLEDIdx].g = newLEDColors[ledIdx].g
 					} else {
-						ledColors[mostLEDIdx+startLEDIdx].b = newLEDColors[mostLEDIdx].b
+						ledColors[ledIdx+startLEDIdx].b = newLEDColors[ledIdx].b
 					}
 				}
 
 				// adding the packet to the group
+				workingGroups[groupIdx].Packets = appendHoldBurst(workingGroups[groupIdx].Packets, holdSlots[groupIdx])
+				workingGroups[groupIdx].Slots += holdSlots[groupIdx] + 1
+				holdSlots[groupIdx] = 0
 				workingGroups[groupIdx].Packets = append(workingGroups[groupIdx].Packets, packet...)
 			}
 		}
 	}
 
 	// adding the last segment
+	flushHolds(workingGroups, holdSlots)
 	doneSegments = append(doneSegments, EncodedSegment{Groups: workingGroups})
 
 	ret := &EncodedFrame{Segments: doneSegments, timeOfFrame: timeOfFrame, startAngle: trueStartAngle}
@@ -239,6 +270,38 @@ func sampleLED(dist, width float64, prevAngle, currAngle float64, img image.Imag
 	return ledColor{byte(r), byte(g), byte(b)}
 }
 
+// Writes out the holds still pending at the end of a segment
+func flushHolds(groups []EncodedGroup, holdSlots []int) {
+	for i := range groups {
+		groups[i].Packets = appendHoldBurst(groups[i].Packets, holdSlots[i])
+		groups[i].Slots += holdSlots[i]
+		holdSlots[i] = 0
+	}
+}
+
+// Appends bursts telling the player to leave the LEDs alone for the given number of slots.
+// Layout is the marker, a zero, then the slot count as a little endian uint16, padded to 8 bytes.
+func appendHoldBurst(packets []byte, slots int) []byte {
+	for slots > 0 {
+		n := slots
+		if n > maxHoldSlots {
+			n = maxHoldSlots
+		}
+		packets = append(packets, holdBurstMarker, 0, byte(n), byte(n>>8), 0, 0, 0, 0)
+		slots -= n
+	}
+
+	return packets
+}
+
+func isHoldBurst(burst []byte) bool {
+	return burst[0]&holdBurstMarker != 0
+}
+
+func holdBurstSlots(burst []byte) int {
+	return int(burst[2]) | int(burst[3])<<8
+}
+
 // ch is 0 for red, 1 for green, 2 for blue
 // ledIdx is relative to the chip. So 0-7. Note that 0 corresponds to D8_LX physically
 func formCommand(ledIdx, ch int, value ledColor) (byte, byte) {
@@ -277,6 +340,7 @@ func EncodeFrames(frames *ffmpeg.FrameArray) []*EncodedFrame {
 func frameEncoderWorker(frames *ffmpeg.FrameArray, startIdx, endIdx int, ret []*EncodedFrame, done chan bool, amtDone *int32) {
 	for i := startIdx; endIdx > i; i++ {
 		frame, _ := EncodeFrame(frames.GetFrame(i), frames.GetFrameTime(), i%2 == 0)
+		frame.KeyFrame = i%keyFrameInterval < 2 // deltas reach two back, so keys come in pairs
 		fmt.Printf("Encoding. %.2f%%\n", float64(atomic.AddInt32(amtDone, 1))/float64(frames.GetNumFrames())*100)
 		ret[i] = frame
 	}
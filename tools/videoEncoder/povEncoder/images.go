@@ -0,0 +1,62 @@
+package povencoder
+
+import (
+	"encoding/binary"
+	"image"
+	"os"
+
+	"github.com/danielcbailey/POVDisplay/tools/videoEncoder/ffmpeg"
+)
+
+// Writes the frames as a .cri image stream, small pictures the player resamples onto the LEDs itself
+// (see runImageReader). Each frame is averaged down to size x size pixels, at 96 that is 27KB a frame.
+func SaveImageStream(frames *ffmpeg.FrameArray, fileName string, size int) error {
+	file, err := os.Create(fileName)
+	if err != nil {
+		return err
+	}
+	defer file.Close()
+
+	header := []byte{'C', 'R', 'I', 0}
+	header = binary.LittleEndian.AppendUint32(header, uint32(frames.GetNumFrames()))
+	header = binary.LittleEndian.AppendUint32(header, uint32(size))
+	header = binary.LittleEndian.AppendUint32(header, uint32(size))
+	header = binary.LittleEndian.AppendUint32(header, uint32(frames.GetFrameTime().Microseconds()))
+	if _, err := file.Write(header); err != nil {
+		return err
+	}
+
+	for i := 0; frames.GetNumFrames() > i; i++ {
+		if _, err := file.Write(shrinkImage(frames.GetFrame(i), size)); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// Averages the image down to size x size, returned as RGB bytes a row at a time from the top.
+func shrinkImage(img image.Image, size int) []byte {
+	bounds := img.Bounds()
+	out := make([]byte, 0, size*size*3)
+	for y := 0; size > y; y++ {
+		y0 := bounds.Min.Y + y*bounds.Dy()/size
+		y1 := bounds.Min.Y + (y+1)*bounds.Dy()/size
+		for x := 0; size > x; x++ {
+			x0 := bounds.Min.X + x*bounds.Dx()/size
+			x1 := bounds.Min.X + (x+1)*bounds.Dx()/size
+
+			var r, g, b, n uint32
+			for sy := y0; y1 > sy || sy == y0; sy++ {
+				for sx := x0; x1 > sx || sx == x0; sx++ {
+					rS, gS, bS, _ := img.At(sx, sy).RGBA()
+					r += rS >> 8
+					g += gS >> 8
+					b += bS >> 8
+					n++
+				}
+			}
+			out = append(out, byte(r/n), byte(g/n), byte(b/n))
+		}
+	}
+	return out
+}
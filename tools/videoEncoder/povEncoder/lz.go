@@ -0,0 +1,125 @@
+package povencoder
+
+import "encoding/binary"
+
+// LZ frames store the frame's raw groups (headers included) as one LZ4 block, see lzDecode in the
+// player. LZ4 only needs byte copies and adds to decode, which suits the M0+, and the player
+// decompresses each sector while the next one is still on the SD bus.
+
+// Compresses frames with LZ4 when that is smaller than the other encodings
+var UseLZ = true
+
+const lzMinMatch = 4
+const lzMaxOffset = 0xFFFF
+const lzHashBits = 12
+const lzLastLiterals = 5 // LZ4 blocks end in at least this many literals
+
+func lzHash(v uint32) uint32 {
+	return v * 2654435761 >> (32 - lzHashBits)
+}
+
+func lzAppendLength(out []byte, length int) []byte {
+	for ; length >= 255; length -= 255 {
+		out = append(out, 255)
+	}
+	return append(out, byte(length))
+}
+
+func lzAppendSequence(out, literals []byte, offset, matchLength int) []byte {
+	token := byte(0)
+	if len(literals) >= 15 {
+		token = 15 << 4
+	} else {
+		token = byte(len(literals)) << 4
+	}
+	if matchLength > 0 {
+		if matchLength-lzMinMatch >= 15 {
+			token |= 15
+		} else {
+			token |= byte(matchLength - lzMinMatch)
+		}
+	}
+
+	out = append(out, token)
+	if len(literals) >= 15 {
+		out = lzAppendLength(out, len(literals)-15)
+	}
+	out = append(out, literals...)
+	if matchLength > 0 {
+		out = binary.LittleEndian.AppendUint16(out, uint16(offset))
+		if matchLength-lzMinMatch >= 15 {
+			out = lzAppendLength(out, matchLength-lzMinMatch-15)
+		}
+	}
+
+	return out
+}
+
+// Greedy LZ4 block compressor, good enough for the runs of similar bursts a frame has
+func lzCompress(src []byte) []byte {
+	out := make([]byte, 0, len(src)/2)
+	table := make([]int, 1<<lzHashBits)
+	for i := range table {
+		table[i] = -1
+	}
+
+	anchor := 0
+	matchLimit := len(src) - lzLastLiterals
+	for pos := 0; pos+lzMinMatch <= matchLimit; {
+		v := binary.LittleEndian.Uint32(src[pos:])
+		h := lzHash(v)
+		candidate := table[h]
+		table[h] = pos
+		if candidate < 0 || pos-candidate > lzMaxOffset || binary.LittleEndian.Uint32(src[candidate:]) != v {
+			pos++
+			continue
+		}
+
+		length := lzMinMatch
+		for pos+length < matchLimit && src[candidate+length] == src[pos+length] {
+			length++
+		}
+
+		out = lzAppendSequence(out, src[anchor:pos], pos-candidate, length)
+		pos += length
+		anchor = pos
+	}
+
+	return lzAppendSequence(out, src[anchor:], 0, 0)
+}
+
+// Walks an LZ4 block the way the player decodes it, calling write with how far into the frame the
+// player has read (block starts at base) before each write, for expandRoom
+func lzRoom(block []byte, base int, write func(in, n int)) {
+	readLength := func(pos, length int) (int, int) {
+		for {
+			b := int(block[pos])
+			pos++
+			length += b
+			if b != 255 {
+				return pos, length
+			}
+		}
+	}
+
+	for pos := 0; pos < len(block); {
+		token := int(block[pos])
+		pos++
+		literals := token >> 4
+		if literals == 15 {
+			pos, literals = readLength(pos, literals)
+		}
+		pos += literals
+		if pos >= len(block) {
+			write(base+pos, literals)
+			return
+		}
+
+		pos += 2
+		matchLength := token & 0xF
+		if matchLength == 15 {
+			pos, matchLength = readLength(pos, matchLength)
+		}
+		write(base+pos, literals+matchLength+lzMinMatch)
+	}
+}
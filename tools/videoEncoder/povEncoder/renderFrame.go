@@ -33,7 +33,7 @@ func renderPartialFrame(frame *EncodedFrame, gc *draw2dimg.GraphicContext, width
 	for i := 0; i < len(groupPacketsPerSecond); i++ {
 		//packetsPerFrame := float64(groupPacketsPerSecond[i]) * frame.timeOfFrame.Seconds()
 		//groupDThetas[i] = 3.1415 / packetsPerFrame
-		groupDThetas[i] = 3.1415 / 2 / float64(len(frame.Segments[0].Groups[i].Packets)/8)
+		groupDThetas[i] = 3.1415 / 2 / float64(frame.Segments[0].Groups[i].Slots)
 	}
 
 	ledColors := make([]ledColor, numLEDs)
@@ -41,20 +41,30 @@ func renderPartialFrame(frame *EncodedFrame, gc *draw2dimg.GraphicContext, width
 	for groupIdx := 0; groupIdx < len(groupPacketsPerSecond); groupIdx++ {
 		i := -1
 		segmentIdx := 0
+		holdLeft := 0
 	gLoop:
 		for theta := frame.startAngle; theta < frame.startAngle+3.1415; theta += groupDThetas[groupIdx] {
-			i++
-			if i*8 >= len(frame.Segments[segmentIdx].Groups[groupIdx].Packets) {
-				segmentIdx++
-				if segmentIdx >= len(frame.Segments) {
-					break gLoop
+			if holdLeft > 0 {
+				// still in a hold, the LEDs keep their colors
+				holdLeft--
+			} else {
+				i++
+				if i*8 >= len(frame.Segments[segmentIdx].Groups[groupIdx].Packets) {
+					segmentIdx++
+					if segmentIdx >= len(frame.Segments) {
+						break gLoop
+					}
+					i = 0
 				}
-				i = 0
-			}
-			packet := frame.Segments[segmentIdx].Groups[groupIdx].Packets[8*i : 8*i+8]
+				packet := frame.Segments[segmentIdx].Groups[groupIdx].Packets[8*i : 8*i+8]
 
-			// first updating the LED colors
-			ledColors = updateLEDColorsFromPacket(packet, ledColors, groupIdx)
+				// first updating the LED colors
+				if isHoldBurst(packet) {
+					holdLeft = holdBurstSlots(packet) - 1
+				} else {
+					ledColors = updateLEDColorsFromPacket(packet, ledColors, groupIdx)
+				}
+			}
 
 			// now draw the arcs
 			for ledIdx := groupIdx * 32; ledIdx < (groupIdx+1)*32; ledIdx++ {
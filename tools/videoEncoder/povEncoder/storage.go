@@ -5,25 +5,84 @@ import (
 	"os"
 )
 
+// Set in the file header flags when groups may contain hold bursts and group headers count slots
+const crvFlagHoldBursts = 0x1
+
+// Set in the file header flags when bursts are bit-packed (see packPairs)
+const crvFlagPackedBursts = 0x2
+
+// Set in the file header flags when every frame header carries the frame's encoding
+const crvFlagFrameEncoding = 0x4
+
+// Set in the file header flags when some frames are deltas, the player then keeps the frame two back around
+const crvFlagDeltaFrames = 0x8
+
+// Set in the file header flags when some frames are LZ compressed
+const crvFlagLZFrames = 0x10
+
+// Frame encodings
+const frameRaw = 0     // bursts as the file flags say
+const framePalette = 1 // bursts hold indices into a value palette stored after the frame header
+const frameDelta = 2   // groups are runs copied from the frame two back, see delta.go
+const frameLZ = 3      // raw groups compressed as one LZ4 block, see lz.go
+
+// Writes bursts as four 13-bit (channel, value) pairs instead of eight bytes. About 19% smaller,
+// the player unpacks them after reading each frame.
+var PackBursts = true
+
+// Stores frames whose values fit in a small palette as palette indices, 5 bytes a burst
+var UsePalette = true
+
+const packedHoldChannel = 31 // not a real channel, marks a packed hold burst
+
+const paletteBits = 5
+const paletteSize = 1 << paletteBits
+const paletteMaxError = 4 // furthest a value may be moved to fit the palette before the frame stays raw
+
 func SaveEncodedVideo(frames []*EncodedFrame, fileName string) error {
 	fBuf := make([]byte, 0, 1024)
 
-	// appending header
-	fBuf = append(fBuf, 'C', 'R', 'V', 0)
+	// appending header, the largest frame length gets filled in once all frames are formed
+	fBuf = append(fBuf, 'C', 'R', 'V', 1)
 	fBuf = binary.LittleEndian.AppendUint32(fBuf, uint32(len(frames)))
+	fBuf = binary.LittleEndian.AppendUint32(fBuf, 0x18) // header length, frame 0 starts here
+	fBuf = binary.LittleEndian.AppendUint32(fBuf, 0)    // largest frame length
+	flags := uint32(crvFlagHoldBursts)
+	// frames only carry an encoding when one of them can be something other than raw, so files of
+	// plain bursts keep the shorter frame header and can still be streamed
+	frameEncoding := UsePalette || UseDelta || UseLZ
+	if frameEncoding {
+		flags |= crvFlagFrameEncoding
+	}
+	if PackBursts {
+		flags |= crvFlagPackedBursts
+	}
+	if UseDelta {
+		flags |= crvFlagDeltaFrames
+	}
+	if UseLZ {
+		flags |= crvFlagLZFrames
+	}
+	fBuf = binary.LittleEndian.AppendUint32(fBuf, flags)
+	fBuf = binary.LittleEndian.AppendUint32(fBuf, 0) // room the player needs to expand the largest frame
+	maxFrameLength := uint32(0)
+	maxExpandRoom := uint32(0)
+	refs := [2][][]byte{} // bursts the player ends up with for the last two frames
 
-	for _, frame := range frames {
+	for n, frame := range frames {
 		// forming segments
 		groupBufs := make([][]byte, len(frame.Segments[0].Groups))
 		groupSegments := make([][][]byte, len(frame.Segments[0].Groups))
+		groupSlots := make([]int, len(frame.Segments[0].Groups))
 		for _, segment := range frame.Segments {
 			for i, group := range segment.Groups {
 				groupSegments[i] = append(groupSegments[i], group.Packets)
+				groupSlots[i] += group.Slots
 			}
 		}
 
 		for i, group := range groupSegments {
-			groupBufs[i] = binary.LittleEndian.AppendUint32(groupBufs[i], uint32(len(group))) // number of "packets"
+			groupBufs[i] = binary.LittleEndian.AppendUint32(groupBufs[i], uint32(groupSlots[i])) // number of slots, holds included
 
 			for _, packet := range group {
 				//groupBufs[i] = binary.LittleEndian.AppendUint16(groupBufs[i], uint16(512))           // rotational proportion, hard coded to 256 for now
@@ -32,33 +91,354 @@ func SaveEncodedVideo(frames []*EncodedFrame, fileName string) error {
 				// copying the packet
 				pCopy := make([]byte, len(packet))
 				copy(pCopy, packet)
-				for i := 1; i < len(pCopy); i += 2 {
-					// applying color correction
-					pCopy[i] = ledColorCorrection(pCopy[i])
+				for j := 0; j < len(pCopy); j += 8 {
+					if isHoldBurst(pCopy[j : j+8]) {
+						continue
+					}
+
+					for k := j + 1; k < j+8; k += 2 {
+						// applying color correction
+						pCopy[k] = ledColorCorrection(pCopy[k])
+					}
 				}
 
 				groupBufs[i] = append(groupBufs[i], pCopy...)
 			}
 		}
 
-		// appending frame
-		offset2 := uint32(0x10 + len(groupBufs[0]))
+		// picking how to store the frame's bursts, whichever takes the fewest bytes
+		rawBursts := make([][]byte, len(groupBufs))
+		for i := range groupBufs {
+			rawBursts[i] = groupBufs[i][4:]
+		}
+
+		encoding := uint32(frameRaw)
+		var encoded, expanded [][]byte
+		var palette []byte
+		encoded, expanded = encodeGroups(rawBursts, 8, nil, nil)
+		if !PackBursts {
+			encoded = rawBursts
+		}
+		bestLength := encodedLength(encoded)
+
+		if p, lookup, ok := choosePalette(groupBufs); UsePalette && ok {
+			pEncoded, pExpanded := encodeGroups(rawBursts, paletteBits, &lookup, p)
+			if l := encodedLength(pEncoded) + len(p); l < bestLength {
+				encoding, encoded, expanded, palette, bestLength = framePalette, pEncoded, pExpanded, p, l
+			}
+		}
+
+		if ref := refs[n%2]; UseDelta && !frame.KeyFrame && ref != nil {
+			dEncoded := make([][]byte, len(rawBursts))
+			dExpanded := make([][]byte, len(rawBursts))
+			for i := range rawBursts {
+				dEncoded[i], dExpanded[i] = deltaGroup(rawBursts[i], ref[i])
+			}
+			if l := encodedLength(dEncoded); l < bestLength {
+				encoding, encoded, expanded, palette, bestLength = frameDelta, dEncoded, dExpanded, nil, l
+			}
+		}
+		var compressed []byte
+		if UseLZ {
+			// the group headers go in the block too, so they count against it here
+			var body []byte
+			for _, groupBuf := range groupBufs {
+				body = append(body, groupBuf...)
+			}
+			c := lzCompress(body)
+			if l := len(c) + 4 - 4*len(groupBufs); l < bestLength {
+				encoding, expanded, palette, bestLength, compressed = frameLZ, rawBursts, nil, l, c
+			}
+		}
+		refs[n%2] = expanded // what the player will have, for the frame two on
+
+		if encoding != frameLZ {
+			for i := range groupBufs {
+				groupBufs[i] = append(groupBufs[i][:4:4], encoded[i]...)
+			}
+		}
+
+		// appending frame, an LZ frame's offsets are where its groups end up once decompressed
+		frameStart := len(fBuf)
+		frameHeaderLength := 0x10 + len(palette)
+		if frameEncoding {
+			frameHeaderLength += 4
+		}
+		offset2 := uint32(frameHeaderLength + len(groupBufs[0]))
 		offset3 := offset2 + uint32(len(groupBufs[1]))
 		offset4 := offset3 + uint32(len(groupBufs[2]))
 		fBuf = binary.LittleEndian.AppendUint32(fBuf, offset2)
 		fBuf = binary.LittleEndian.AppendUint32(fBuf, offset3)
 		fBuf = binary.LittleEndian.AppendUint32(fBuf, offset4)
-		fBuf = binary.LittleEndian.AppendUint32(fBuf, offset4+uint32(len(groupBufs[3]))) // appending the length of the frame
+		frameLength := offset4 + uint32(len(groupBufs[3]))
+		if encoding == frameLZ {
+			fBuf = binary.LittleEndian.AppendUint32(fBuf, uint32(0x18+len(compressed)))
+			fBuf = binary.LittleEndian.AppendUint32(fBuf, encoding)
+			fBuf = binary.LittleEndian.AppendUint32(fBuf, frameLength) // expanded length
+			fBuf = append(fBuf, compressed...)
+			frameLength = uint32(0x18 + len(compressed))
+		} else {
+			fBuf = binary.LittleEndian.AppendUint32(fBuf, frameLength) // appending the length of the frame
+			if frameEncoding {
+				fBuf = binary.LittleEndian.AppendUint32(fBuf, encoding)
+			}
+			fBuf = append(fBuf, palette...)
+			for _, groupBuf := range groupBufs {
+				fBuf = append(fBuf, groupBuf...)
+			}
+		}
 
-		for _, groupBuf := range groupBufs {
-			fBuf = append(fBuf, groupBuf...)
+		if frameLength > maxFrameLength {
+			maxFrameLength = frameLength
+		}
+		if room := expandRoom(fBuf[frameStart:], flags); room > maxExpandRoom {
+			maxExpandRoom = room
 		}
 	}
 
+	binary.LittleEndian.PutUint32(fBuf[0xC:], maxFrameLength)
+	binary.LittleEndian.PutUint32(fBuf[0x14:], maxExpandRoom)
+
 	// creating the file
 	return os.WriteFile(fileName, fBuf, 0644)
 }
 
+// Packs every group with packPairs. Returns the packed groups and the bursts the player will expand them to.
+func encodeGroups(groups [][]byte, valueBits int, lookup *[256]byte, palette []byte) ([][]byte, [][]byte) {
+	encoded := make([][]byte, len(groups))
+	expanded := make([][]byte, len(groups))
+	for i, group := range groups {
+		encoded[i], expanded[i] = packPairs(group, valueBits, lookup, palette)
+	}
+
+	return encoded, expanded
+}
+
+func encodedLength(groups [][]byte) int {
+	length := 0
+	for _, group := range groups {
+		length += len(group)
+	}
+
+	return length
+}
+
+// Mirrors how the player expands a frame in place (see loadNewFrame) and returns how many bytes a
+// frame buffer needs for it. The frame is read into the end of the buffer and expanded from the front,
+// so the expanded bursts must never catch up with the bytes still to be expanded.
+func expandRoom(frame []byte, flags uint32) uint32 {
+	encoding := uint32(frameRaw)
+	groupStarts := []int{0x10, 0, 0, 0}
+	if flags&crvFlagFrameEncoding != 0 {
+		encoding = binary.LittleEndian.Uint32(frame[0x10:])
+		groupStarts[0] = 0x14
+	}
+	if encoding == frameRaw && flags&crvFlagPackedBursts == 0 {
+		return uint32(len(frame)) // played from where it was read
+	}
+
+	groupEnds := make([]int, 4)
+	for i := 0; i < 4; i++ {
+		groupEnds[i] = int(binary.LittleEndian.Uint32(frame[4*i:]))
+		if i < 3 {
+			groupStarts[i+1] = groupEnds[i]
+		}
+	}
+	if encoding == framePalette {
+		groupStarts[0] += paletteSize
+	}
+
+	out, worst := 0, 0
+	write := func(in, n int) {
+		// in is how far the player has read when it writes the next n bytes
+		out += n
+		if out-in > worst {
+			worst = out - in
+		}
+	}
+
+	if encoding == frameLZ {
+		lzRoom(frame[0x18:], 0x18, write)
+		return uint32(len(frame) + worst)
+	}
+
+	for i := 0; i < 4; i++ {
+		in := groupStarts[i] + 4
+		if encoding == frameDelta {
+			for in+4 <= groupEnds[i] {
+				copies := int(binary.LittleEndian.Uint16(frame[in:]))
+				literals := int(binary.LittleEndian.Uint16(frame[in+2:]))
+				in += 4
+				write(in, 8*copies)
+				for k := 1; k <= literals; k++ {
+					if flags&crvFlagPackedBursts != 0 {
+						write(in+k*52/8, 8)
+					} else {
+						write(in+k*8, 8)
+					}
+				}
+				if flags&crvFlagPackedBursts != 0 {
+					in += (literals*52 + 7) / 8
+				} else {
+					in += literals * 8
+				}
+			}
+		} else {
+			burstBits := 52
+			if encoding == framePalette {
+				burstBits = 4 * (5 + paletteBits)
+			}
+			bursts := (groupEnds[i] - in) * 8 / burstBits
+			for k := 1; k <= bursts; k++ {
+				write(in+k*burstBits/8, 8)
+			}
+		}
+	}
+
+	return uint32(len(frame) + worst)
+}
+
+// Packs each burst's four (command, value) pairs into a 5-bit channel and a valueBits value, least
+// significant bit first with no padding between bursts. Values are swapped for their palette index
+// when there is a lookup. Holds become a pair on channel 31, with the slot count spread over the
+// values of the first three pairs, lowest bits first. Returns the packed bursts and the bursts the
+// player will expand them to.
+func packPairs(bursts []byte, valueBits int, lookup *[256]byte, palette []byte) ([]byte, []byte) {
+	out := make([]byte, 0, (len(bursts)/8*(20+4*valueBits)+7)/8)
+	pairBits := 5 + valueBits
+	maxSlots := 1<<(3*valueBits) - 1
+	if maxSlots > maxHoldSlots {
+		maxSlots = maxHoldSlots
+	}
+
+	acc := uint32(0)
+	bits := 0
+	expanded := make([]byte, 0, len(bursts))
+	appendPair := func(channel, value byte) {
+		acc |= (uint32(channel) | uint32(value)<<5) << bits
+		bits += pairBits
+		for bits >= 8 {
+			out = append(out, byte(acc))
+			acc >>= 8
+			bits -= 8
+		}
+	}
+
+	for j := 0; j+8 <= len(bursts); j += 8 {
+		burst := bursts[j : j+8]
+		if isHoldBurst(burst) {
+			// smaller values may not reach the whole count, so it can take more than one hold
+			for slots := holdBurstSlots(burst); slots > 0; {
+				n := slots
+				if n > maxSlots {
+					n = maxSlots
+				}
+				mask := 1<<valueBits - 1
+				appendPair(packedHoldChannel, byte(n&mask))
+				appendPair(0, byte(n>>valueBits&mask))
+				appendPair(0, byte(n>>(2*valueBits)&mask))
+				appendPair(0, 0)
+				expanded = append(expanded, holdBurstMarker, 0, byte(n), byte(n>>8), 0, 0, 0, 0)
+				slots -= n
+			}
+			continue
+		}
+
+		for k := 0; k < 4; k++ {
+			value := burst[2*k+1]
+			if lookup != nil {
+				value = lookup[value]
+			}
+			appendPair(burst[2*k]>>1-0x10, value)
+
+			if lookup != nil {
+				value = palette[value]
+			}
+			expanded = append(expanded, burst[2*k], value)
+		}
+	}
+
+	if bits > 0 {
+		out = append(out, byte(acc))
+	}
+
+	return out, expanded
+}
+
+type paletteLevel struct {
+	lo, hi, value, count int
+}
+
+func mergePaletteLevels(a, b paletteLevel) paletteLevel {
+	ret := paletteLevel{lo: a.lo, hi: b.hi, value: a.value, count: a.count + b.count}
+	if b.count > a.count {
+		ret.value = b.value
+	}
+
+	return ret
+}
+
+// furthest any value covered by the level is from the level's value
+func (l paletteLevel) maxError() int {
+	if l.value-l.lo > l.hi-l.value {
+		return l.value - l.lo
+	}
+
+	return l.hi - l.value
+}
+
+// Picks up to paletteSize values covering every value in the frame's bursts. While there are too many,
+// the neighbouring pair that moves values the least is merged, keeping the more common of the two.
+// Returns false if some value still ends up more than paletteMaxError away from its level.
+func choosePalette(groupBufs [][]byte) ([]byte, [256]byte, bool) {
+	counts := [256]int{}
+	for _, groupBuf := range groupBufs {
+		for j := 4; j+8 <= len(groupBuf); j += 8 {
+			if isHoldBurst(groupBuf[j : j+8]) {
+				continue
+			}
+
+			for k := j + 1; k < j+8; k += 2 {
+				counts[groupBuf[k]]++
+			}
+		}
+	}
+
+	levels := make([]paletteLevel, 0, 256)
+	for v, c := range counts {
+		if c > 0 {
+			levels = append(levels, paletteLevel{lo: v, hi: v, value: v, count: c})
+		}
+	}
+
+	for len(levels) > paletteSize {
+		best, bestErr := 0, 256
+		for i := 0; i+1 < len(levels); i++ {
+			if e := mergePaletteLevels(levels[i], levels[i+1]).maxError(); e < bestErr {
+				best, bestErr = i, e
+			}
+		}
+
+		levels[best] = mergePaletteLevels(levels[best], levels[best+1])
+		levels = append(levels[:best+1], levels[best+2:]...)
+	}
+
+	var lookup [256]byte
+	palette := make([]byte, paletteSize)
+	for i, l := range levels {
+		if l.maxError() > paletteMaxError {
+			return nil, lookup, false
+		}
+
+		palette[i] = byte(l.value)
+		for v := l.lo; v <= l.hi; v++ {
+			lookup[v] = byte(i)
+		}
+	}
+
+	return palette, lookup, true
+}
+
 var interpTable = [16]byte{
 	0,
 	2,
@@ -0,0 +1,33 @@
+package povencoder
+
+import (
+	"os"
+)
+
+// Sectors on one card before the video carries on on the other, STRIPE_SECTORS in playerConfig.h
+const StripeSectors = 8
+
+const sectorSize = 512
+
+// Splits a .crv file into the two card images striped playback reads. Each image goes onto its card's
+// raw sectors from sector 0 (dd or any disk imager), with no filesystem. The video is cut into
+// StripeSectors sector stripes that take turns between the cards, so reading a frame keeps both busy.
+func SaveStripedImages(crvFileName string, card0FileName string, card1FileName string) error {
+	video, err := os.ReadFile(crvFileName)
+	if err != nil {
+		return err
+	}
+
+	stripeSize := StripeSectors * sectorSize
+	var cards [2][]byte
+	for i := 0; i*stripeSize < len(video); i++ {
+		stripe := make([]byte, stripeSize) // the last one is padded with zeros
+		copy(stripe, video[i*stripeSize:])
+		cards[i%2] = append(cards[i%2], stripe...)
+	}
+
+	if err := os.WriteFile(card0FileName, cards[0], 0644); err != nil {
+		return err
+	}
+	return os.WriteFile(card1FileName, cards[1], 0644)
+}
@@ -0,0 +1,61 @@
+package povencoder
+
+import (
+	"encoding/binary"
+	"fmt"
+	"os"
+	"strings"
+)
+
+// Where flash playback expects the video, FLASH_VIDEO_OFFSET in playerConfig.h
+const FlashVideoOffset = 1024 * 1024
+
+const flashBase = 0x10000000
+const flashSize = 2 * 1024 * 1024 // the board's QSPI flash
+
+const uf2Magic0 = 0x0A324655
+const uf2Magic1 = 0x9E5D5157
+const uf2MagicEnd = 0x0AB16F30
+const uf2FlagFamilyID = 0x00002000
+const uf2FamilyRP2040 = 0xE48BFF56
+const uf2PayloadSize = 256 // one flash page per block, what the boot ROM expects
+
+// Packs a .crv file for flash playback. A .uf2 output can be dropped onto the board in BOOTSEL mode
+// next to the firmware, anything else gets the plain image for picotool (load it at the offset).
+func SaveFlashImage(crvFileName string, fileName string) error {
+	video, err := os.ReadFile(crvFileName)
+	if err != nil {
+		return err
+	}
+	if len(video) > flashSize-FlashVideoOffset {
+		return fmt.Errorf("video is %d bytes, only %d fit in flash after the firmware", len(video), flashSize-FlashVideoOffset)
+	}
+
+	if !strings.HasSuffix(strings.ToLower(fileName), ".uf2") {
+		return os.WriteFile(fileName, video, 0644)
+	}
+
+	numBlocks := (len(video) + uf2PayloadSize - 1) / uf2PayloadSize
+	out := make([]byte, 0, numBlocks*512)
+	for i := 0; i < numBlocks; i++ {
+		end := (i + 1) * uf2PayloadSize
+		if end > len(video) {
+			end = len(video)
+		}
+		payload := make([]byte, 476) // padded with zeros past the page and past the end of the video
+		copy(payload, video[i*uf2PayloadSize:end])
+
+		out = binary.LittleEndian.AppendUint32(out, uf2Magic0)
+		out = binary.LittleEndian.AppendUint32(out, uf2Magic1)
+		out = binary.LittleEndian.AppendUint32(out, uf2FlagFamilyID)
+		out = binary.LittleEndian.AppendUint32(out, uint32(flashBase+FlashVideoOffset+i*uf2PayloadSize))
+		out = binary.LittleEndian.AppendUint32(out, uf2PayloadSize)
+		out = binary.LittleEndian.AppendUint32(out, uint32(i))
+		out = binary.LittleEndian.AppendUint32(out, uint32(numBlocks))
+		out = binary.LittleEndian.AppendUint32(out, uf2FamilyRP2040)
+		out = append(out, payload...)
+		out = binary.LittleEndian.AppendUint32(out, uf2MagicEnd)
+	}
+
+	return os.WriteFile(fileName, out, 0644)
+}
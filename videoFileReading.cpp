@@ -3,121 +3,879 @@
 #include "pico/stdlib.h"
 #include "hardware/sync.h"
 #include "videoFileReading.h"
+#include "frameDecoding.h"
+#include "frameSource.h"
+#include "frameSynthesis.h"
 #include <stdio.h> // FOR TESTING ONLY
+#include <stdlib.h>
+#include <string.h>
 
-FIL fil;
+#define CRV_VERSION 1 // newest file header version this player understands
+#define CRV_KNOWN_FLAGS (CRV_FLAG_HOLD_BURSTS | CRV_FLAG_PACKED_BURSTS | CRV_FLAG_FRAME_ENCODING | CRV_FLAG_DELTA_FRAMES | CRV_FLAG_LZ_FRAMES | \
+                         CRV_FLAG_SECTOR_ALIGNED | CRV_FLAG_CONTIGUOUS)
 
-unsigned char frameBuffers[2][73728];
-volatile int bufferLengths[4]; // in number of bursts
-volatile unsigned char* groupBuffers[4] = {NULL, NULL, NULL, NULL};
-int frameBufferFilled = 0;
-volatile int lastBufferFilled[4] = {0, 0, 0, 0}; // if equal to buffersGiven, then should start filling the next buffer
+FrameSource* source = NULL; // where the video being played comes from
+SdFileSource sdSource;
 
+#if !STREAMING_PLAYBACK
+typedef struct {
+    unsigned char* data;
+    unsigned char* groups[4];
+    uint32_t bursts[4];
+    uint32_t slots[4];
+    int32_t frameIndex; // which frame of the file is in the slot
+    uint32_t fileLength; // bytes the frame takes in the file
+} FrameSlot;
+
+unsigned char frameArena[FRAME_ARENA_SIZE] __attribute__((aligned(4)));
+FrameSlot framePool[FRAME_POOL_MAX_SLOTS];
+int frameSlotCount = 0;
+uint32_t frameSlotSize = 0;
+
+// slots are filled and played in order, so two counters make the queue between the cores
+volatile uint32_t framesLoaded = 0; // written by the reader only
+volatile uint32_t framesTaken = 0; // written by core 1 only
+volatile uint32_t lastTakeTime = 0; // when core 1 last took a frame, written by core 1 only
+volatile uint32_t takeInterval = 0; // time between the last two, 0 until it has taken two
+bool ramLoop = false; // the whole video is in the pool, so frames only get handed over again
+
+// the first frames of the video stay in the arena after the first pass, so at the wrap they are
+// handed over straight away while the reader seeks back and gets ahead again
+FrameSlot loopCache[LOOP_CACHE_FRAMES];
+int loopCacheCount = 0; // frames the arena had room to pin
+int loopCacheFilled = 0; // frames pinned so far
+uint32_t loopCacheFree[LOOP_CACHE_FRAMES]; // framesTaken count at which core 1 is done with each pinned frame
+#endif
+
+uint32_t firstFrame = 0x8;
 uint32_t nextFrame = 0x8;
 int32_t frameNumber = -1;
-uint32_t groupNumPackets[4] = {0, 0, 0, 0}; // number of packets in the group for this frame
-volatile bool fetchFrame = true;
 
 uint32_t numberFrames;
+uint32_t maxFrameLength = 0;
+uint32_t maxExpandRoom = 0; // bytes a slot needs to expand the largest frame in place
+uint32_t fileFlags = 0;
 
 uint32_t fetchTime = 0;
+uint32_t unpackTime = 0;
+uint32_t deltaSkips = 0; // delta frames dropped because the frame they build on wasn't loaded
+uint32_t droppedFrames = 0; // frames whose read failed or ran past when core 1 needed them
+uint32_t lzDecodeTime = 0; // time spent decompressing the last LZ frame, overlapped with its read
+
+typedef struct {
+    char filename[PLAYLIST_NAME_LENGTH];
+    uint32_t repeats; // times through the file before the next one, 0 to stay on it
+} PlaylistEntry;
+
+PlaylistEntry playlist[PLAYLIST_MAX_ENTRIES];
+int playlistLength = 0;
+int playlistPos = 0;
+uint32_t filePasses = 0; // times the current file has wrapped
+uint32_t transitionTime = 0; // opening the next file and fetching its first frame, last playlist switch
+uint32_t maxTransitionTime = 0;
+
+uint32_t synthTime = 0; // building the last scene frame, has to stay under SCENE_FRAME_TIME_US
+uint32_t maxSynthTime = 0;
+uint32_t synthLateFrames = 0; // scene frames that took longer to build than to show
+
+#if !STREAMING_PLAYBACK
+Scene imageScene;
+uint32_t imagePixels[IMAGE_MAX_PIXELS]; // the image on show, SCENE_RGB
+uint32_t imageCount = 0;
+uint32_t imageFramesEach = 1; // scene frames each image stays up for
+uint32_t imageReadTime = 0; // reading and unpacking the last image
+#endif
 
 void loadNewFrame();
+void streamFrames();
+uint32_t scanMaxFrameLength();
+void setupFramePool(uint32_t frameLength, uint32_t expandRoom, uint32_t flags);
+void readVideoHeader();
+void playFrames();
+void playVideo();
+
+// Makes videoSource the one frames are read from and opens the named video on it.
+void openVideo(FrameSource* videoSource, const char* name) {
+    source = videoSource;
+    if (!source->open(name)) {
+        panic("Can't open video %s\n", name ? name : "");
+    }
+}
+
+void runReader(FrameSource* videoSource, const char* name) {
+    openVideo(videoSource, name);
+    playVideo();
+}
 
 void runFileReader(const char* filename) {
-    FRESULT res = f_open(&fil, filename, FA_READ);
-    if (FR_OK != res && FR_EXIST != res)
-        panic("f_open(%s) error: %s (%d)\n", filename, FRESULT_str(res), res);
+    runReader(&sdSource, filename);
+}
+
+void runFlashReader() {
+    static FlashSource flashSource(FLASH_VIDEO_OFFSET);
+    runReader(&flashSource, NULL);
+}
+
+void runStripedReader() {
+    static StripedSource stripedSource(0, 1, STRIPE_SECTORS);
+    runReader(&stripedSource, NULL);
+}
+
+void runPlaylist(const char* filename) {
+    FIL list;
+    if (FR_OK != f_open(&list, filename, FA_READ)) {
+        return; // no playlist, so it's just video.crv
+    }
+
+    // a line per file: the name, then how many times to play it (once if left out)
+    char line[PLAYLIST_NAME_LENGTH + 16];
+    while (playlistLength < PLAYLIST_MAX_ENTRIES && f_gets(line, sizeof(line), &list)) {
+        char* name = line;
+        while (' ' == *name || '\t' == *name) {
+            name++;
+        }
+        size_t nameLength = strcspn(name, " \t\r\n");
+        if (0 == nameLength || '#' == name[0]) {
+            continue;
+        }
+        if (nameLength >= PLAYLIST_NAME_LENGTH) {
+            panic("Playlist entry %.*s is too long\n", (int)nameLength, name);
+        }
+
+        PlaylistEntry* entry = &playlist[playlistLength++];
+        memcpy(entry->filename, name, nameLength);
+        entry->filename[nameLength] = 0;
+        char* count = name + nameLength;
+        entry->repeats = strtoul(count, &count, 10);
+        if (count == name + nameLength) {
+            entry->repeats = 1;
+        }
+    }
+    f_close(&list);
+    if (0 == playlistLength) {
+        return;
+    }
+
+#if STREAMING_PLAYBACK
+    printf("Playlists need whole-frame playback, playing %s\n", playlist[0].filename);
+    runFileReader(playlist[0].filename);
+#else
+    // the pool stays put across files, so it is sized for the largest frames of all of them
+    uint32_t frameLength = 0;
+    uint32_t expandRoom = 0;
+    uint32_t flags = 0;
+    for (int i = 0; playlistLength > i; i++) {
+        openVideo(&sdSource, playlist[i].filename);
+        readVideoHeader();
+        source->close();
+        if (maxFrameLength > frameLength) {
+            frameLength = maxFrameLength;
+        }
+        if (maxExpandRoom > expandRoom) {
+            expandRoom = maxExpandRoom;
+        }
+        flags |= fileFlags;
+    }
+    printf("Playlist of %d files\n", playlistLength);
+
+    openVideo(&sdSource, playlist[0].filename);
+    readVideoHeader();
+    setupFramePool(frameLength, expandRoom, flags);
+    playFrames();
+#endif
+}
+
+#if !STREAMING_PLAYBACK
+void runSceneReader(Scene* scene, void (*updateScene)(Scene* scene, uint32_t frame)) {
+    frameSlotSize = (synthFrameLength() + 3) & ~3u;
+    frameSlotCount = sizeof(frameArena) / frameSlotSize;
+    if (frameSlotCount > 3) {
+        frameSlotCount = 3; // live content shouldn't sit in a long queue, one on show and two ready
+    }
+    if (frameSlotCount < 2) {
+        panic("Scene frames of %u bytes don't fit twice in the %u byte frame arena\n", frameSlotSize, sizeof(frameArena));
+    }
+    for (int i = 0; frameSlotCount > i; i++) {
+        framePool[i].data = frameArena + i * frameSlotSize;
+        framePool[i].frameIndex = -1;
+    }
+
+    for (uint32_t frame = 0;; frame++) {
+        while (framesLoaded - framesTaken >= (uint32_t)frameSlotCount - 1) {
+            __wfe(); // sleep until core 1 takes a frame
+        }
+
+        if (updateScene) {
+            updateScene(scene, frame);
+        }
+        FrameSlot* slot = &framePool[framesLoaded % frameSlotCount];
+        uint32_t startTime = time_us_32();
+        synthesizeFrame(scene, frame % 2 == 0, slot->data, slot->groups, slot->bursts, slot->slots);
+        synthTime = time_us_32() - startTime;
+        if (synthTime > maxSynthTime) {
+            maxSynthTime = synthTime;
+        }
+        if (synthTime > SCENE_FRAME_TIME_US) {
+            synthLateFrames++;
+        }
+        slot->frameIndex = frame;
+
+        __dmb(); // slot must be visible before core 1 can take it
+        framesLoaded = framesLoaded + 1;
+    }
+}
+#endif
+
+#if !STREAMING_PLAYBACK
+// Reads the next image in when the one on show has had its time.
+void updateImageScene(Scene* scene, uint32_t frame) {
+    if (frame % imageFramesEach || (1 == imageCount && frame > 0)) {
+        return;
+    }
+
+    uint32_t startTime = time_us_32();
+    uint32_t pixels = scene->elements[0].width * scene->elements[0].height;
+    uint32_t index = (frame / imageFramesEach) % imageCount;
+    unsigned char* rgb = (unsigned char*)imagePixels + pixels; // RGB goes at the end and is spread out towards the front
+    if (source->read(rgb, 0x14 + index * pixels * 3, pixels * 3) != pixels * 3) {
+        panic("Image %u is cut short\n", index);
+    }
+    for (uint32_t i = 0; pixels > i; i++, rgb += 3) {
+        imagePixels[i] = SCENE_RGB(rgb[0], rgb[1], rgb[2]);
+    }
+    imageReadTime = time_us_32() - startTime;
+}
+
+void runImageReader(FrameSource* videoSource, const char* name) {
+    openVideo(videoSource, name);
+
+    uint32_t header[5];
+    if (source->read(header, 0, sizeof(header)) != sizeof(header)) {
+        panic("Image file header is cut short\n");
+    }
+    const char* id = (const char*)header;
+    if (id[0] != 'C' || id[1] != 'R' || id[2] != 'I') {
+        panic("Invalid file format. Expected .cri\n");
+    }
+    if (id[3] > 0) {
+        panic("Unsupported .cri version %d\n", id[3]);
+    }
+    imageCount = header[1];
+    uint32_t width = header[2];
+    uint32_t height = header[3];
+    if (0 == imageCount || 0 == width || 0 == height || width * height > IMAGE_MAX_PIXELS) {
+        panic("Images of %ux%u don't fit the %u pixel image buffer\n", width, height, IMAGE_MAX_PIXELS);
+    }
+    imageFramesEach = (header[4] + SCENE_FRAME_TIME_US / 2) / SCENE_FRAME_TIME_US;
+    if (0 == imageFramesEach) {
+        imageFramesEach = 1;
+    }
+
+    // the LEDs span all but 4 pixels either side of the image, as in EncodeFrame
+    uint32_t span = width > 8 ? width - 8 : width;
+    SceneElement* image = &imageScene.elements[0];
+    imageScene.background = SCENE_RGB(0, 0, 0);
+    imageScene.elementCount = 1;
+    image->kind = SCENE_IMAGE;
+    image->pixels = imagePixels;
+    image->width = width;
+    image->height = height;
+    image->scale = (128 * 16 + span / 2) / span;
+    image->x = -(int32_t)(width * image->scale / 2);
+    image->y = height * image->scale / 2;
+    printf("%u images of %ux%u, %u frames each\n", imageCount, width, height, imageFramesEach);
+
+    runSceneReader(&imageScene, updateImageScene);
+}
+
+void runImageFileReader(const char* filename) {
+    if (FR_OK != f_stat(filename, NULL)) {
+        return; // no images, play the video instead
+    }
+    runImageReader(&sdSource, filename);
+}
+#endif
+
+// Checks the video's header and plays it until the power goes.
+void playVideo() {
+    readVideoHeader();
+
+#if STREAMING_PLAYBACK
+    if (fileFlags & (CRV_FLAG_PACKED_BURSTS | CRV_FLAG_DELTA_FRAMES | CRV_FLAG_LZ_FRAMES)) {
+        panic("Packed or encoded frames need whole-frame playback\n"); // chunks are sent straight from the file
+    }
+    streamFrames();
+#else
+    setupFramePool(maxFrameLength, maxExpandRoom, fileFlags);
+    playFrames();
+#endif
+}
+
+// Reads the video's header into the file globals and gets ready to read its first frame.
+void readVideoHeader() {
+    firstFrame = 0x8;
+    maxFrameLength = 0;
+    maxExpandRoom = 0;
+    fileFlags = 0;
+    frameNumber = -1;
 
     // checking file format
     char buffer[4];
-    UINT bytesRead;
-    res = f_read(&fil, buffer, sizeof(buffer), &bytesRead);
-    if (FR_OK != res)
-        panic("f_read() error: %s (%d)\n", FRESULT_str(res), res);
+    source->read(buffer, 0, sizeof(buffer));
 
-    if (buffer[0] != 'C' || buffer[1] != 'R' || buffer[2] != 'V' || buffer[3] != 0) {
+    if (buffer[0] != 'C' || buffer[1] != 'R' || buffer[2] != 'V') {
         panic("Invalid file format. Expected .crv\n"); // CRV stands for Compressed Rotational Video
     }
+    if (buffer[3] > CRV_VERSION) {
+        panic("Unsupported .crv version %d\n", buffer[3]);
+    }
 
     // reading the number of frames
     uint32_t numFrames;
-    res = f_read(&fil, &numFrames, sizeof(numFrames), &bytesRead);
-    if (FR_OK != res)
-        panic("f_read() error: %s (%d)\n", FRESULT_str(res), res);
+    source->read(&numFrames, 4, sizeof(numFrames));
 
     numberFrames = numFrames;
 
+    if (buffer[3] >= 1) {
+        // version 1 headers say where the frames start and how big the largest one is
+        uint32_t headerFields[4];
+        if (source->read(headerFields, 8, sizeof(headerFields)) < 8)
+            panic("File header is cut short\n");
+        firstFrame = headerFields[0];
+        maxFrameLength = headerFields[1];
+        if (firstFrame >= 0x14) {
+            fileFlags = headerFields[2]; // older headers end before the flags
+        }
+        if (firstFrame >= 0x18) {
+            maxExpandRoom = headerFields[3];
+        }
+    }
+    if (fileFlags & ~CRV_KNOWN_FLAGS) {
+        panic("Unsupported .crv flags 0x%x\n", fileFlags);
+    }
+    if ((fileFlags & CRV_FLAG_CONTIGUOUS) && !(source->capabilities() & FrameSource::CONTIGUOUS)) {
+        // still plays, but frames that cross fragments take more than one transaction
+        printf("Video was laid out in one run but has been fragmented since, rebuild the card with cardImage\n");
+    }
+    nextFrame = firstFrame;
+
+    if (0 == maxFrameLength) {
+        maxFrameLength = scanMaxFrameLength(); // older files don't say, so go and look
+    }
+    if (0 == maxExpandRoom) {
+        maxExpandRoom = maxFrameLength;
+        if (fileFlags & CRV_FLAG_PACKED_BURSTS) {
+            maxExpandRoom += 3 * maxFrameLength / 13 + 16; // unpacked bursts are 64/52 the size
+        }
+    }
+}
+
+#if !STREAMING_PLAYBACK
+// Keeps the frame pool topped up, moving on through the playlist if there is one.
+void playFrames() {
     while (true) {
-        while (!fetchFrame) {
-            // busy waiting
+        while (framesLoaded - framesTaken >= (uint32_t)frameSlotCount - 1) {
+            // busy waiting, every free slot is full (core 1 holds the remaining one)
+            if (ramLoop) {
+                __wfe(); // nothing else to do, sleep until core 1 takes a frame
+            }
+        }
+
+        if (ramLoop && framesLoaded >= (uint32_t)frameSlotCount) {
+            // every slot still holds the frame that goes in it next time round
+            framesLoaded = framesLoaded + 1;
+            continue;
         }
 
-        // loading the next frame
+        // loading the next frame, from the next file once this one has played enough times. The
+        // pool is still full of this file's last frames, so core 1 plays those while the next opens
         uint32_t startTime = time_us_32();
+        bool switching = playlistLength > 1 && -1 == frameNumber && playlist[playlistPos].repeats > 0 &&
+                         filePasses >= playlist[playlistPos].repeats;
+        if (switching) {
+            source->close();
+            playlistPos = (playlistPos + 1) % playlistLength;
+            openVideo(source, playlist[playlistPos].filename);
+            readVideoHeader();
+            filePasses = 0;
+            loopCacheFilled = 0; // the pinned frames belong to the last file
+        }
         loadNewFrame();
         fetchTime = time_us_32() - startTime;
+        if (switching) {
+            transitionTime = fetchTime;
+            if (transitionTime > maxTransitionTime) {
+                maxTransitionTime = transitionTime;
+            }
+        }
     }
 }
+#endif
 
-void loadNewFrame() {
-    // seeking the file to the next frame
-    f_lseek(&fil, nextFrame);
-    UINT bytesRead;
-    uint32_t group2Offset;
-    f_read(&fil, &group2Offset, sizeof(group2Offset), &bytesRead);
-    uint32_t group3Offset;
-    f_read(&fil, &group3Offset, sizeof(group3Offset), &bytesRead);
-    uint32_t group4Offset;
-    f_read(&fil, &group4Offset, sizeof(group4Offset), &bytesRead);
-    uint32_t frameLength;
-    f_read(&fil, &frameLength, sizeof(frameLength), &bytesRead);
-
-    // reading the frame
-    int bufToUse = (frameBufferFilled + 1) % 2;
-    f_read(&fil, frameBuffers[bufToUse], frameLength - 0x10, &bytesRead);
+// How far on the next frame starts.
+uint32_t frameStride(uint32_t frameLength) {
+    if (fileFlags & CRV_FLAG_SECTOR_ALIGNED) {
+        return (frameLength + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1);
+    }
+    return frameLength;
+}
 
-    // updating the group variables
-    groupBuffers[0] = frameBuffers[bufToUse] + 0x14; // the +4 is to skip over the segment count (useless now)
-    groupBuffers[1] = frameBuffers[bufToUse] + group2Offset + 0x4 - 0x10;
-    groupBuffers[2] = frameBuffers[bufToUse] + group3Offset + 0x4 - 0x10;
-    groupBuffers[3] = frameBuffers[bufToUse] + group4Offset + 0x4 - 0x10;
+// Walks the frame headers to find the largest frame, for files whose header doesn't record it.
+uint32_t scanMaxFrameLength() {
+    uint32_t maxLength = 0;
+    FSIZE_t pos = firstFrame;
+    for (uint32_t i = 0; numberFrames > i; i++) {
+        uint32_t header[4];
+        if (sizeof(header) != source->read(header, pos, sizeof(header)) || header[3] < sizeof(header))
+            panic("Frame %u header is corrupt\n", i);
+
+        if (header[3] > maxLength) {
+            maxLength = header[3];
+        }
+        pos += frameStride(header[3]);
+    }
+    return maxLength;
+}
+
+#if !STREAMING_PLAYBACK
+// Carves the arena into as many slots as the largest frame allows.
+void setupFramePool(uint32_t frameLength, uint32_t expandRoom, uint32_t flags) {
+    // frames are read as whole sectors, so a slot needs a sector of slack on either side of the frame.
+    // Frames that get expanded are read into the end and expanded towards the front, so the slot
+    // has to hold the expanded frame plus a little room for the reading to stay ahead.
+    uint32_t slotLength = frameLength;
+    if (expandRoom + 16 > slotLength) {
+        slotLength = expandRoom + 16;
+    }
+    frameSlotSize = (slotLength + 2 * SECTOR_SIZE + 3) & ~3u;
+    int arenaSlots = sizeof(frameArena) / frameSlotSize;
+    frameSlotCount = arenaSlots;
+    if (frameSlotCount > FRAME_POOL_MAX_SLOTS) {
+        frameSlotCount = FRAME_POOL_MAX_SLOTS;
+    }
+    if (frameSlotCount < 2) {
+        // one slot is always on display, so anything less can't be played
+        panic("Frames of up to %u bytes don't fit twice in the %u byte frame arena\n", frameLength, sizeof(frameArena));
+    }
+#if RAM_LOOP_PLAYBACK
+    // a slot per frame (a single frame goes in twice, core 1 holds one), filled once and then
+    // played round and round without touching the card again
+    uint32_t loopSlots = numberFrames < 2 ? 2 : numberFrames;
+    if (loopSlots <= (uint32_t)frameSlotCount && playlistLength <= 1) {
+        frameSlotCount = loopSlots;
+        ramLoop = true;
+        printf("Video fits in RAM, looping it from there\n");
+    }
+#endif
+    if (frameSlotCount < 3 && (flags & CRV_FLAG_DELTA_FRAMES) && !ramLoop) {
+        // the frame two back has to stay put while the next one is built on top of it
+        panic("Delta frames need three frame buffers, frames of up to %u bytes only fit twice\n", frameLength);
+    }
+
+    if (!ramLoop && !(source->capabilities() & FrameSource::SEEK_FREE)) {
+        // the loop cache gets whatever the pool doesn't use, plus slots from the pool as long as
+        // it keeps three (enough for delta frames and a frame of read-ahead)
+        loopCacheCount = LOOP_CACHE_FRAMES;
+        if ((uint32_t)loopCacheCount > numberFrames) {
+            loopCacheCount = numberFrames;
+        }
+        if (loopCacheCount > arenaSlots - 3) {
+            loopCacheCount = arenaSlots > 3 ? arenaSlots - 3 : 0;
+        }
+        if (frameSlotCount > arenaSlots - loopCacheCount) {
+            frameSlotCount = arenaSlots - loopCacheCount;
+        }
+    }
+
+    for (int i = 0; frameSlotCount > i; i++) {
+        framePool[i].data = frameArena + i * frameSlotSize;
+        framePool[i].frameIndex = -1;
+    }
+    for (int i = 0; loopCacheCount > i; i++) {
+        loopCache[i].data = frameArena + (frameSlotCount + i) * frameSlotSize;
+    }
+    printf("Frame pool: %d slots of %u bytes, %d frames pinned for the loop\n", frameSlotCount, frameSlotSize, loopCacheCount);
+}
+#endif
+
+// Bits per value for frames whose bursts have to be expanded, 0 if they are stored ready to send
+// (delta frames expand their literals as they are decoded, LZ frames decompress to raw bursts).
+int frameValueBits(int encoding) {
+    if (FRAME_DELTA == encoding || FRAME_LZ == encoding) {
+        return 0;
+    }
+    if (FRAME_PALETTE == encoding) {
+        return FRAME_PALETTE_BITS;
+    }
+    if (fileFlags & CRV_FLAG_PACKED_BURSTS) {
+        return 8;
+    }
+    return 0;
+}
+
+// Works out where each group's bursts start (relative to the frame) and how many there are
+// from the frame header: group 2, 3 and 4 offsets, the frame length, then the encoding if
+// the file has one per frame. LZ frames describe their groups as they are once decompressed,
+// with the expanded frame length after the encoding. Returns the frame's encoding.
+int parseFrameHeader(const uint32_t header[6], uint32_t groupOffsets[4], uint32_t groupBursts[4]) {
+    int encoding = FRAME_RAW;
+    uint32_t groupStart = 0x10;
+    uint32_t frameEnd = header[3];
+    if (fileFlags & CRV_FLAG_FRAME_ENCODING) {
+        encoding = header[4];
+        groupStart = 0x14;
+        if (FRAME_PALETTE == encoding) {
+            groupStart += FRAME_PALETTE_SIZE;
+        }
+        if (FRAME_LZ == encoding) {
+            frameEnd = header[5];
+        }
+    }
+
+    groupOffsets[0] = groupStart + 0x4; // the +4 is to skip over the group header
+    groupOffsets[1] = header[0] + 0x4;
+    groupOffsets[2] = header[1] + 0x4;
+    groupOffsets[3] = header[2] + 0x4;
 
-    groupNumPackets[0] = (group2Offset - 0x14) / 8;
-    groupNumPackets[1] = (group3Offset - group2Offset - 0x4) / 8;
-    groupNumPackets[2] = (group4Offset - group3Offset - 0x4) / 8;
-    groupNumPackets[3] = (frameLength - group4Offset - 0x14) / 8;
+    groupBursts[0] = (header[0] - groupOffsets[0]) / 8;
+    groupBursts[1] = (header[1] - header[0] - 0x4) / 8;
+    groupBursts[2] = (header[2] - header[1] - 0x4) / 8;
+    groupBursts[3] = (frameEnd - header[2] - 0x4) / 8;
 
+    int valueBits = frameValueBits(encoding);
+    if (valueBits) {
+        // packed groups end mid-byte, so count how many whole bursts fit in each one
+        uint32_t groupEnds[4] = {header[0], header[1], header[2], header[3]};
+        for (int i = 0; 4 > i; i++) {
+            groupBursts[i] = (groupEnds[i] - groupOffsets[i]) * 8 / (4 * (5 + valueBits));
+        }
+    }
+    return encoding;
+}
+
+// Moves on to the frame after the one just read, wrapping at the end of the file.
+void advanceFrame(uint32_t frameLength) {
     frameNumber++;
-    frameBufferFilled = bufToUse;
-    fetchFrame = false; // reset the flag
-    if (frameNumber >= numberFrames) {
+    if (frameNumber + 1 >= (int32_t)numberFrames) {
         frameNumber = -1;
-        nextFrame = 0x8;
+        nextFrame = firstFrame;
+        filePasses++;
     } else {
-        nextFrame = nextFrame + frameLength;
+        nextFrame = nextFrame + frameStride(frameLength);
     }
 }
 
+#if !STREAMING_PLAYBACK
+// When core 1 will want the frame being loaded: one frame time after it takes the last of the ones
+// queued ahead of it. 0 for no deadline.
+uint32_t frameDeadline() {
+#if READ_DEADLINES
+    if (0 == takeInterval) {
+        return 0; // core 1 hasn't got going yet
+    }
+    uint32_t now = time_us_32();
+    uint32_t due = lastTakeTime + (framesLoaded - framesTaken + 1) * takeInterval;
+    if ((int32_t)(due - now) < READ_MIN_BUDGET_US) {
+        due = now + READ_MIN_BUDGET_US; // already behind, dropping every frame from here won't catch up
+    }
+    return due ? due : 1;
+#else
+    return 0;
+#endif
+}
+
+void loadNewFrame() {
+    FrameSlot* slot = &framePool[framesLoaded % frameSlotCount];
+    int32_t index = frameNumber + 1;
+    if (loopCacheFilled > index) {
+        // pinned on the first pass, the slot only needs pointing at it
+        unsigned char* data = slot->data;
+        *slot = loopCache[index];
+        slot->data = data;
+        loopCacheFree[index] = framesLoaded + 2;
+        __dmb(); // slot must be visible before core 1 can take it
+        framesLoaded = framesLoaded + 1;
+        advanceFrame(slot->fileLength);
+        return;
+    }
+    FrameSlot* pin = NULL;
+    if (loopCacheCount > index && loopCacheFilled == index && framesTaken >= loopCacheFree[index]) {
+        pin = &loopCache[index]; // goes straight into the cache, the slot gets pointed at it
+    }
+    unsigned char* data = pin ? pin->data : slot->data;
+
+    // seeking the file to the next frame. A header that doesn't come in is read again next time
+    // round, core 1 shows the last frame meanwhile
+    uint32_t header[6];
+    if (source->read(header, nextFrame, sizeof(header)) < 0x10) {
+        droppedFrames++;
+        return;
+    }
+    if (header[3] > maxFrameLength) {
+        panic("Frame %d is %u bytes, larger than the %u the file promised\n", frameNumber + 1, header[3], maxFrameLength);
+    }
+
+    uint32_t groupOffsets[4];
+    int encoding = parseFrameHeader(header, groupOffsets, slot->bursts);
+    if (encoding > FRAME_LZ) {
+        panic("Frame %d has unknown encoding %d\n", frameNumber + 1, encoding);
+    }
+
+    FrameSlot* ref = NULL;
+    if (FRAME_DELTA == encoding) {
+        if (!(fileFlags & CRV_FLAG_DELTA_FRAMES)) {
+            panic("Frame %d is a delta but the file doesn't say it has any\n", frameNumber + 1);
+        }
+        ref = &framePool[(framesLoaded + frameSlotCount - 2) % frameSlotCount];
+        if (framesLoaded < 2 || ref->frameIndex != frameNumber - 1) {
+            // nothing to build on (the previous frame was dropped), wait for the next key frame
+            deltaSkips++;
+            advanceFrame(header[3]);
+            return;
+        }
+    }
+
+    // reading the frame, frames that need expanding go at the end of the slot and get expanded towards the front
+    int valueBits = frameValueBits(encoding);
+    bool compressed = FRAME_LZ == encoding;
+    bool expands = valueBits || ref || compressed;
+    unsigned char* readBuf = data;
+    if (expands) {
+        uint32_t unpackedLength = 8 * (slot->bursts[0] + slot->bursts[1] + slot->bursts[2] + slot->bursts[3]);
+        if (compressed) {
+            unpackedLength = header[5] - 0x14; // group headers included
+        }
+        if ((valueBits || compressed) && unpackedLength > maxExpandRoom) {
+            panic("Frame %d expands to %u bytes, larger than the %u the file promised\n", frameNumber + 1, unpackedLength, maxExpandRoom);
+        }
+        readBuf = data + ((frameSlotSize - header[3] - 2 * SECTOR_SIZE) & ~3u);
+    }
+
+    uint32_t startTime = time_us_32();
+    unsigned char* frame;
+    // the RAM loop only gets one go at each frame, so it takes as long as it takes the first time round
+    source->setDeadline(ramLoop ? 0 : frameDeadline());
+    if (compressed) {
+        // the groups decompress to the front of the slot as they come in, group 1's header first. Sources
+        // that hold the CPU while they read get the whole frame in first and it decompresses after
+        LzDecoder lz;
+        frame = readBuf + nextFrame % SECTOR_SIZE;
+        lzBegin(&lz, frame + 0x18, header[3] - 0x18, data, header[5] - 0x14);
+        bool overlapped = source->capabilities() & FrameSource::ASYNC;
+        if (!source->fetch(readBuf, nextFrame, header[3], overlapped ? &lz : NULL)) {
+            frame = NULL;
+        } else if (lzDecode(&lz, lz.inEnd) != 1) {
+            panic("Frame %d doesn't decompress\n", frameNumber + 1);
+        } else {
+            lzDecodeTime = time_us_32() - startTime;
+            frame = data;
+            for (int i = 0; 4 > i; i++) {
+                groupOffsets[i] -= 0x14; // the decompressed groups start at data, where the frame header would end
+            }
+        }
+    } else {
+        frame = source->fetch(readBuf, nextFrame, header[3], NULL);
+    }
+    if (!frame) {
+        // core 1 shows the last frame again rather than wait, and delta frames after this one get
+        // skipped until the next key frame. The RAM loop reads it again instead, as its slot is never
+        // filled again
+        droppedFrames++;
+        if (!ramLoop) {
+            advanceFrame(header[3]);
+        }
+        return;
+    }
+
+    unsigned char palette[FRAME_PALETTE_SIZE];
+    if (FRAME_PALETTE == encoding) {
+        memcpy(palette, frame + 0x14, sizeof(palette)); // expanding will run over it
+    }
+
+    // updating the group variables
+    startTime = time_us_32();
+    unsigned char* unpacked = data;
+    uint32_t groupEnds[4] = {header[0], header[1], header[2], header[3]};
+    for (int i = 0; 4 > i; i++) {
+        slot->groups[i] = frame + groupOffsets[i];
+        uint32_t slots = 0;
+        memcpy(&slots, slot->groups[i] - 4, 4); // read before expanding runs over the group header
+        if (ref) {
+            int32_t bursts = decodeDeltaGroup(slot->groups[i], groupEnds[i] - groupOffsets[i], ref->groups[i], ref->bursts[i],
+                                              unpacked, (data + maxExpandRoom - unpacked) / 8, fileFlags & CRV_FLAG_PACKED_BURSTS);
+            if (bursts < 0) {
+                panic("Frame %d group %d doesn't fit the frame it builds on\n", frameNumber + 1, i + 1);
+            }
+            slot->bursts[i] = bursts;
+        }
+        slot->slots[i] = slot->bursts[i];
+        if (fileFlags & CRV_FLAG_HOLD_BURSTS) {
+            slot->slots[i] = slots; // group header holds the slot count
+        }
+        if (valueBits) {
+            expandBursts(slot->groups[i], unpacked, slot->bursts[i], valueBits, FRAME_PALETTE == encoding ? palette : NULL);
+        }
+        if (valueBits || ref) {
+            slot->groups[i] = unpacked;
+            unpacked += slot->bursts[i] * 8;
+        }
+    }
+    if (valueBits || ref) {
+        unpackTime = time_us_32() - startTime;
+    }
+    slot->frameIndex = frameNumber + 1;
+    slot->fileLength = header[3];
+    if (pin) {
+        *pin = *slot;
+        pin->data = data;
+        loopCacheFilled++;
+        loopCacheFree[index] = framesLoaded + 2;
+    }
+
+    __dmb(); // slot must be visible before core 1 can take it
+    framesLoaded = framesLoaded + 1;
+    advanceFrame(header[3]);
+}
+#endif
+
+#if STREAMING_PLAYBACK
+StreamChunk streamRings[4][STREAM_RING_CHUNKS];
+int streamWriteIdx[4] = {0, 0, 0, 0};
+int streamReadIdx[4] = {0, 0, 0, 0};
+
+void streamFrames() {
+    while (true) {
+        uint32_t startTime = time_us_32();
+
+        uint32_t header[6];
+        source->read(header, nextFrame, sizeof(header));
+        uint32_t groupOffsets[4];
+        uint32_t groupBursts[4];
+        if (FRAME_RAW != parseFrameHeader(header, groupOffsets, groupBursts)) {
+            // files with an encoding per frame stream as long as every frame is stored raw
+            panic("Frame %d is encoded, it needs whole-frame playback\n", frameNumber + 1);
+        }
+
+        uint32_t groupChunks[4];
+        uint32_t nextChunk[4] = {0, 0, 0, 0};
+        for (int i = 0; 4 > i; i++) {
+            groupChunks[i] = (groupBursts[i] + STREAM_CHUNK_BURSTS - 1) / STREAM_CHUNK_BURSTS;
+        }
+
+        while (true) {
+            // picking the group whose next chunk core 1 will reach first
+            int group = -1;
+            for (int i = 0; 4 > i; i++) {
+                if (nextChunk[i] >= groupChunks[i]) {
+                    continue;
+                }
+                if (group < 0 || nextChunk[i] * groupChunks[group] < nextChunk[group] * groupChunks[i]) {
+                    group = i;
+                }
+            }
+            if (group < 0) {
+                break; // whole frame handed over
+            }
+
+            StreamChunk* chunk = &streamRings[group][streamWriteIdx[group]];
+            while (chunk->ready) {
+                // busy waiting for core 1 to free the slot
+            }
+            __dmb();
+
+            uint32_t firstBurst = nextChunk[group] * STREAM_CHUNK_BURSTS;
+            uint32_t bursts = groupBursts[group] - firstBurst;
+            if (bursts > STREAM_CHUNK_BURSTS) {
+                bursts = STREAM_CHUNK_BURSTS;
+            }
+            chunk->frameSlots = groupBursts[group];
+            if (firstBurst == 0 && (fileFlags & CRV_FLAG_HOLD_BURSTS)) {
+                // group header holds the slot count, it sits right before the bursts
+                source->readStream(group, &chunk->frameSlots, nextFrame + groupOffsets[group] - 4, 4);
+            }
+            // each group reads as its own stream, so each keeps its own sector cache while their reads interleave
+            source->readStream(group, chunk->data, nextFrame + groupOffsets[group] + firstBurst * 8, bursts * 8);
+            chunk->bursts = bursts;
+            chunk->frameStart = firstBurst == 0;
+
+            __dmb(); // data must be visible before the flag
+            chunk->ready = true;
+            streamWriteIdx[group] = (streamWriteIdx[group] + 1) % STREAM_RING_CHUNKS;
+            nextChunk[group]++;
+        }
+
+        advanceFrame(header[3]);
+        fetchTime = time_us_32() - startTime;
+    }
+}
+
+StreamChunk* getStreamChunk(int group) {
+    StreamChunk* chunk = &streamRings[group][streamReadIdx[group]];
+    if (!chunk->ready) {
+        return NULL;
+    }
+    __dmb();
+    return chunk;
+}
+
+void releaseStreamChunk(int group) {
+    __dmb(); // finish reading before the reader may overwrite it
+    streamRings[group][streamReadIdx[group]].ready = false;
+    streamReadIdx[group] = (streamReadIdx[group] + 1) % STREAM_RING_CHUNKS;
+}
+#endif
+
+unsigned char* borrowFrameMemory(uint32_t* size) {
+#if STREAMING_PLAYBACK
+    *size = sizeof(streamRings);
+    return (unsigned char*)streamRings;
+#else
+    *size = sizeof(frameArena);
+    return frameArena;
+#endif
+}
+
 uint32_t getBufCalls = 0;
 uint32_t timeGetLastCalled[4] = {0, 0, 0, 0};
 uint32_t timeDiffBetweenLastCalled[4] = {0, 0, 0, 0};
 
+uint32_t frameRepeats = 0; // times core 1 wanted a frame and had to show the last one again
+
+#if !STREAMING_PLAYBACK
 GroupBufferInfo getGroupBuffers() {
-    // while (buffersGiven[groupNumber] == lastBufferFilled[groupNumber]) {
-    //     // busy waiting
-    // }
-    __dsb();
-    GroupBufferInfo ret;
-    ret.group1Buf = (unsigned char*)groupBuffers[0];
-    ret.group2Buf = (unsigned char*)groupBuffers[1];
-    ret.group3Buf = (unsigned char*)groupBuffers[2];
-    ret.group4Buf = (unsigned char*)groupBuffers[3];
-    ret.group1BufLength = groupNumPackets[0];
-    ret.group2BufLength = groupNumPackets[1];
-    ret.group3BufLength = groupNumPackets[2];
-    ret.group4BufLength = groupNumPackets[3];
-    fetchFrame = true; // signal to load a new frame
+    while (0 == framesLoaded) {
+        // busy waiting for the very first frame
+    }
+    __dmb();
+
+    uint32_t now = time_us_32();
+    if (0 != lastTakeTime) {
+        takeInterval = now - lastTakeTime;
+    }
+    lastTakeTime = now;
+
+    if (framesLoaded != framesTaken) {
+        framesTaken = framesTaken + 1; // hands the slot we were showing back to the reader
+    } else {
+        frameRepeats++; // reader is behind, keep showing the frame we have
+    }
     __dmb();
+    __sev(); // wakes the reader if it sleeps waiting for a free slot
+
+    FrameSlot* slot = &framePool[(framesTaken - 1) % frameSlotCount];
+    GroupBufferInfo ret;
+    ret.group1Buf = slot->groups[0];
+    ret.group2Buf = slot->groups[1];
+    ret.group3Buf = slot->groups[2];
+    ret.group4Buf = slot->groups[3];
+    ret.group1BufLength = slot->bursts[0];
+    ret.group2BufLength = slot->bursts[1];
+    ret.group3BufLength = slot->bursts[2];
+    ret.group4BufLength = slot->bursts[3];
+    ret.group1Slots = slot->slots[0];
+    ret.group2Slots = slot->slots[1];
+    ret.group3Slots = slot->slots[2];
+    ret.group4Slots = slot->slots[3];
     return ret;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -1,4 +1,9 @@
+#include "playerConfig.h"
+#include "frameSynthesis.h"
 
+// First byte of a hold burst: the group's LEDs are left alone for the number of slots in
+// bytes 2-3 (uint16). Real commands are always even so they can't be mistaken for it.
+#define HOLD_BURST 0x01
 
 typedef struct {
     unsigned char* group1Buf;
@@ -10,9 +15,58 @@ typedef struct {
     int group2BufLength;
     int group3BufLength;
     int group4BufLength;
+
+    int group1Slots; // slots the bursts cover, more than the bursts when the frame has holds
+    int group2Slots;
+    int group3Slots;
+    int group4Slots;
 } GroupBufferInfo;
 
+// One piece of a group's burst stream (streaming playback only).
+typedef struct {
+    volatile bool ready; // set by the reader once the bursts are resident, cleared by core 1 when sent
+    bool frameStart; // first chunk of the group for a new frame
+    int bursts; // bursts in this chunk
+    int frameSlots; // slots in the group for the whole frame, valid on frameStart
+    unsigned char data[STREAM_CHUNK_BURSTS * 8];
+} StreamChunk;
+
+class FrameSource;
+
+// Plays the named video from source until the power goes (see frameSource.h).
+void runReader(FrameSource* source, const char* name);
+
 void runFileReader(const char* filename);
 
+// Plays the files listed in a playlist one after another, each line being a file name and how many
+// times to play it through (once if left out, 0 for forever). Only returns if there is no playlist.
+void runPlaylist(const char* filename);
+
+// Plays the video written to flash at FLASH_VIDEO_OFFSET (flash playback only).
+void runFlashReader();
+
+// Plays the video striped over the first two cards (striped playback only).
+void runStripedReader();
+
+// Builds frames from the scene on the spot and plays them until the power goes, calling updateScene
+// (if given) before each frame so it can move things along (whole-frame playback only).
+void runSceneReader(Scene* scene, void (*updateScene)(Scene* scene, uint32_t frame));
+
+// Plays a stream of small pictures (.cri), resampled onto the bar as it goes round (whole-frame playback only).
+void runImageReader(FrameSource* source, const char* name);
+
+// Plays the named .cri file off the card. Only returns if there isn't one.
+void runImageFileReader(const char* filename);
+
+// Lends out the frame buffers (the chunk rings in streaming playback) to something that runs before
+// anything plays. They have to be handed back zeroed.
+unsigned char* borrowFrameMemory(uint32_t* size);
+
 // When called, marks previous buffer as free and returns the next buffer.
-GroupBufferInfo getGroupBuffers();
\ No newline at end of file
+GroupBufferInfo getGroupBuffers();
+
+// Returns the group's next chunk if it is resident, otherwise NULL.
+StreamChunk* getStreamChunk(int group);
+
+// Hands the group's current chunk back to the reader.
+void releaseStreamChunk(int group);